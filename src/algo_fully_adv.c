@@ -6,6 +6,7 @@ The module contains the code concerning the fully adversary algorithm on GPS poi
 #include "query.h"
 #include "data_fully_adv.h"
 #include "algo_fully_adv.h"
+#include "operation_stream.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,19 +16,41 @@ The module contains the code concerning the fully adversary algorithm on GPS poi
 
 void
 fully_adv_initialise_level(Fully_adv_cluster * level, unsigned int k,
-			   double radius, void * array,
-			   unsigned int nb_points, unsigned int cluster_size)
+			   double radius, void * array, Unit_vector * units,
+			   unsigned int nb_points, unsigned int cluster_size,
+			   int use_grid, struct set_membership *membership)
 {
 	level->nb = 0;
 	level->k = k;
 	level->radius = radius;
-	initialise_set_collection(&(level->clusters), k + 1, cluster_size,
-				  nb_points);
+	if (NULL == membership)
+		initialise_set_collection(&(level->clusters), k + 1,
+					  cluster_size, nb_points);
+	else
+		initialise_set_collection_shared(&(level->clusters), k + 1,
+						 cluster_size, membership);
 	level->centers =
 	    (unsigned int *)malloc_wrapper(sizeof(*(level->centers)) * (k + 1));
 	level->true_rad = (double *)malloc_wrapper(sizeof(double) * k);
+	initialise_center_mirror(&(level->mirror), k);
+	level->grid = NULL;
+	if (use_grid) {
+		level->grid = malloc_wrapper(sizeof(*level->grid));
+		initialise_center_grid(level->grid, k, radius);
+	}
+	level->nb_points = nb_points;
+	level->array = array;
+	level->units = units;
+}
+
+void fully_adv_resize_level(Fully_adv_cluster * level, void *array,
+			    Unit_vector * units, unsigned int nb_points)
+{
+	if (nb_points > level->nb_points)
+		resize_set_collection(&(level->clusters), nb_points);
 	level->nb_points = nb_points;
 	level->array = array;
+	level->units = units;
 }
 
 void fully_adv_delete_level(Fully_adv_cluster * level)
@@ -35,31 +58,45 @@ void fully_adv_delete_level(Fully_adv_cluster * level)
 	free_set_collection(&(level->clusters));
 	free(level->centers);
 	free(level->true_rad);
+	free_center_mirror(&(level->mirror));
+	if (NULL != level->grid) {
+		free_center_grid(level->grid);
+		free(level->grid);
+		level->grid = NULL;
+	}
 	level->centers = NULL;
 	level->nb_points = 0;
 	level->array = NULL;
+	level->units = NULL;
+}
+
+unsigned int fully_adv_nb_instances(double eps, double d_min, double d_max)
+{
+	return (unsigned int)(1 + ceil(log(d_max / d_min) / log(1 + eps)));
 }
 
 void fully_adv_initialise_level_array(Fully_adv_cluster * levels[],
 				      unsigned int k, double eps, double d_min,
 				      double d_max, unsigned int *nb_instances,
-				      void *points,
+				      void *points, Unit_vector * units,
 				      unsigned int nb_points,
 				      unsigned int cluster_size,
-				      unsigned int *helper_array[])
+				      unsigned int *helper_array[],
+				      int use_grid,
+				      struct set_membership *membership)
 {
 	unsigned int i;
 	unsigned int tmp;
-	*nb_instances = tmp = (unsigned int)(1 + ceil(log(d_max / d_min) /
-						      log(1 + eps)));
+	*nb_instances = tmp = fully_adv_nb_instances(eps, d_min, d_max);
 	*levels = (Fully_adv_cluster *) malloc_wrapper(sizeof(**levels) * tmp);
 	*helper_array =
 	    (unsigned int *)malloc_wrapper(sizeof(**helper_array) * nb_points);
-	fully_adv_initialise_level((*levels), k, 0, points, nb_points,
-				   cluster_size);
+	fully_adv_initialise_level((*levels), k, 0, points, units, nb_points,
+				   cluster_size, use_grid, membership);
 	for (i = 1; i < tmp; i++) {
 		fully_adv_initialise_level((*levels) + i, k, d_min, points,
-					   nb_points, cluster_size);
+					   units, nb_points, cluster_size,
+					   use_grid, membership);
 		d_min = (1 + eps) * d_min;
 	}
 }
@@ -90,19 +127,26 @@ void fully_adv_k_center_add(Fully_adv_cluster * level, unsigned int index)
 {
 	unsigned int i;
 	double tmp;
-	for (i = 0; i < level->nb; i++) {
-		tmp = fully_adv_distance(level->array + index,
-					 level->array + level->centers[i]);
-		if (level->radius >= tmp) {
-			add_element_set_collection(&(level->clusters), index,
-						   i);
-			level->true_rad[i] = MAX(tmp, level->true_rad[i]);
-			return;
-		}
+	Geo_point *point = fully_adv_get_point(level->array, index);
+	Unit_vector *unit = UNIT_VECTOR_AT(level->units, index);
+	if (NULL != level->grid && level->nb >= CENTER_GRID_MIN_CENTERS)
+		i = first_center_within_grid(level->grid, point, unit,
+					     level->radius, &tmp);
+	else
+		i = first_center_within_mirror(&(level->mirror), point, unit,
+					       level->radius, &tmp);
+	if (i < level->nb) {
+		add_element_set_collection(&(level->clusters), index, i);
+		level->true_rad[i] = MAX(tmp, level->true_rad[i]);
+		return;
 	}
 	add_element_set_collection(&(level->clusters), index, level->nb);
 	if (level->nb < level->k) {
 		level->centers[level->nb] = index;
+		if (NULL != level->grid)
+			insert_center_grid(level->grid, level->nb, point,
+					   unit);
+		set_center_mirror(&(level->mirror), level->nb, point, unit);
 		level->true_rad[level->nb] = 0;
 		level->nb++;
 	}
@@ -117,6 +161,9 @@ fully_adv_k_center_delete(Fully_adv_cluster * level, unsigned int element_index,
 	remove_element_set_collection(&(level->clusters), element_index);
 	if (cluster_index < level-> k && element_index == level->centers[cluster_index]) {
 		level->nb = cluster_index;
+		if (NULL != level->grid)
+			truncate_center_grid(level->grid, cluster_index);
+		truncate_center_mirror(&(level->mirror), cluster_index);
 		remove_all_elements_after_set(&(level->clusters),
 					      cluster_index, helper_array,
 					      &size);
@@ -146,19 +193,19 @@ Error_enum fully_adv_write_log(Fully_adv_cluster levels[],
 		if (result == nb_instances) {
 			printf
 			    ("Error, no feasible radius possible found after inserting %u\n",
-			     query->data_index);
+			     query->id);
 			return ONLY_BAD_LEVELS_ERROR;
 		}
 		if (has_long_log())
 			fprintf(get_log_file(), "%c %u %u c%u %lf %lf %u\n",
-				key, query->data_index, nb_points, result,
+				key, query->id, nb_points, result,
 				levels[result].radius,
 				fully_adv_compute_true_radius(levels +
 							      result),
 				levels[result].nb);
 		else
 			fprintf(get_log_file(), "%c %u %u c%u %lf %u\n", key,
-				query->data_index, nb_points, result,
+				query->id, nb_points, result,
 				levels[result].radius, levels[result].nb);
 	}
 	return NO_ERROR;
@@ -171,7 +218,7 @@ fully_adv_apply_one_query(Fully_adv_cluster levels[], unsigned int nb_instances,
 	unsigned int i;
 	static unsigned int nb_points = 0;
 	if (query->type == ADD) {
-		printf("a %u\n", query->data_index);
+		printf("a %u\n", query->id);
 		nb_points++;
 		for (i = 0; i < nb_instances; i++)
 			fully_adv_k_center_add(levels + i, query->data_index);
@@ -195,3 +242,26 @@ fully_adv_k_center_run(Fully_adv_cluster levels[], unsigned int nb_instances,
 					  helper_array);
 	}
 }
+
+void
+fully_adv_k_center_stream(Fully_adv_cluster levels[],
+			  unsigned int nb_instances,
+			  struct operation_stream *stream,
+			  unsigned int *helper_array[])
+{
+	struct query query;
+	unsigned int i;
+	while (read_operation(stream, &query)) {
+		if (stream->range != levels[0].nb_points) {
+			free(*helper_array);
+			*helper_array = malloc_wrapper(sizeof(**helper_array) *
+						       stream->range);
+		}
+		for (i = 0; i < nb_instances; i++)
+			fully_adv_resize_level(levels + i, stream->points,
+					       stream->units,
+					       (unsigned int)stream->range);
+		fully_adv_apply_one_query(levels, nb_instances, &query,
+					  *helper_array);
+	}
+}
@@ -8,6 +8,9 @@ The module contains the code concerning the fully adversary algorithm on GPS poi
 #include "data_fully_adv.h"
 #include "set.h"
 #include "query.h"
+#include "center_mirror.h"
+#include "center_grid.h"
+#include "operation_stream.h"
 
 #include <stdint.h>
 
@@ -17,25 +20,51 @@ typedef struct {
 	double radius;		/* maximum cluster radius of current level */
 	unsigned int *centers;	/* index of center of each cluster */
 	double *true_rad;	/* exact radius of each cluster */
+	struct center_mirror mirror;	/* coordinates of all centers */
+	struct center_grid *grid;	/* spatial index of all centers, used instead of mirror when not NULL and there are enough centers */
 	struct set_collection clusters;	/* content of all clusters */
 	unsigned int nb_points;	/* total number of points in array */
 	void *array;	/* pointer to all points */
+	Unit_vector *units;	/* unit vector of each point of array, NULL unless the great-circle metric is used */
 } Fully_adv_cluster;
 
+/**
+ * @fully_adv_initialise_level : initialise @level, its clusters taking a level of @membership, or a membership table of their own if it is NULL
+ */
 void fully_adv_initialise_level(Fully_adv_cluster * level, unsigned int k,
-				double radius, void * array,
+				double radius, void * array, Unit_vector * units,
 				unsigned int nb_points,
-				unsigned int cluster_size);
+				unsigned int cluster_size, int use_grid,
+				struct set_membership *membership);
+
+/**
+ * @fully_adv_resize_level : let @level cluster the elements from 0 to @nb_points - 1, whose coordinates are now in @array and their unit vectors in @units
+ */
+void fully_adv_resize_level(Fully_adv_cluster * level, void *array,
+			    Unit_vector * units, unsigned int nb_points);
 
 void fully_adv_delete_level(Fully_adv_cluster * clusters);
 
+/**
+ * @fully_adv_nb_instances : number of levels from @d_min to @d_max
+ */
+unsigned int fully_adv_nb_instances(double eps, double d_min, double d_max);
+
+/**
+ * @fully_adv_initialise_level_array : initialise the levels from @d_min to @d_max, whose clusters share @membership, or have a membership table of their own if it is NULL
+ *
+ * @remark : @units gives the unit vectors of @points with the great-circle metric, NULL otherwise, see @unit_vector_array
+ * @remark : @membership must have a level for each level of the array, and is freed by the caller after @fully_adv_delete_level_array
+ */
 void fully_adv_initialise_level_array(Fully_adv_cluster * levels[],
 				      unsigned int k, double eps, double d_min,
 				      double d_max, unsigned int *nb_instances,
-				      void *points,
+				      void *points, Unit_vector * units,
 				      unsigned int nb_points,
 				      unsigned int cluster_size,
-				      unsigned int *helper_array[]);
+				      unsigned int *helper_array[],
+				      int use_grid,
+				      struct set_membership *membership);
 
 void fully_adv_delete_level_array(Fully_adv_cluster levels[],
 				  unsigned int nb_instances,
@@ -52,4 +81,12 @@ void fully_adv_k_center_delete(Fully_adv_cluster * level,
 void fully_adv_k_center_run(Fully_adv_cluster levels[],
 			    unsigned int nb_instances, struct query_provider * queries,
 			    unsigned int *helper_array);
+
+/**
+ * @fully_adv_k_center_stream : apply the operations of @stream one after the other, the levels and @helper_array growing with the number of slots of @stream
+ */
+void fully_adv_k_center_stream(Fully_adv_cluster levels[],
+			       unsigned int nb_instances,
+			       struct operation_stream *stream,
+			       unsigned int *helper_array[]);
 #endif
@@ -7,6 +7,7 @@ The module contains the code concerning the packed fully adversary algorithm on
 #include "algo_packed.h"
 #include "data_packed.h"
 #include "lookup.h"
+#include "operation_stream.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,21 +18,39 @@ The module contains the code concerning the packed fully adversary algorithm on
 void
 packed_initialise_level(Packed_level * level, unsigned int k,
 			double base_radius, unsigned int nb_level,
-			void * array, unsigned int nb_points)
+			void * array, Unit_vector * units,
+			unsigned int nb_points)
 {
 	unsigned int i;
 	initialise_lookup(&(level->lookup), k, nb_level, nb_points);
 	level->array = array;
+	level->units = units;
 	level->nb_points = nb_points;
 	level->radius = malloc(sizeof(*level->radius) * nb_level);
+	level->mirrors = malloc_wrapper(sizeof(*level->mirrors) * nb_level);
 	for (i = 0; i < nb_level; i++) {
 		level->radius[i] = base_radius;
 		base_radius *= 2;
+		initialise_center_mirror(level->mirrors + i, k);
 	}
 }
 
+void packed_resize_level(Packed_level * level, void *array,
+			 Unit_vector * units, unsigned int nb_points)
+{
+	if (nb_points > level->nb_points)
+		resize_lookup(&(level->lookup), nb_points);
+	level->nb_points = nb_points;
+	level->array = array;
+	level->units = units;
+}
+
 void packed_free_level(Packed_level * level)
 {
+	unsigned int i;
+	for (i = 0; i < level->lookup.nb_level; i++)
+		free_center_mirror(level->mirrors + i);
+	free(level->mirrors);
 	free(level->radius);
 	free_lookup(&(level->lookup));
 }
@@ -39,7 +58,7 @@ void packed_free_level(Packed_level * level)
 void packed_initialise_levels_array(Packed_level * levels[], unsigned int k,
 				    double eps, double d_min, double d_max,
 				    unsigned int *nb_instances,
-				    void * array,
+				    void * array, Unit_vector * units,
 				    unsigned int nb_points)
 {
 	unsigned int nb_level_total =
@@ -53,7 +72,7 @@ void packed_initialise_levels_array(Packed_level * levels[], unsigned int k,
 	for (i = 0; i < nb_groups; i++) {
 		flag = i < leftovers ? 1 : 0;
 		packed_initialise_level(*levels + i, k, d_min,
-					level_per_group + flag, array,
+					level_per_group + flag, array, units,
 					nb_points);
 		d_min = (1 + eps) * d_min;
 	}
@@ -91,30 +110,43 @@ void packed_get_index_smallest(Packed_level levels[],
 	}
 }
 
+/**
+ * Copy in the mirror of level level_index the coordinates of the centers from index from up to the first empty cluster.
+ */
+static void packed_sync_mirror(Packed_level * level, unsigned int level_index,
+			       unsigned int from)
+{
+	struct lookup_table *lookup = &(level->lookup);
+	struct center_mirror *mirror = level->mirrors + level_index;
+	struct lookup_node **ptr_node;
+	truncate_center_mirror(mirror, from);
+	ptr_node = lookup->lookup_table + lookup->k * level_index + from;
+	for (; from < lookup->k && *ptr_node; from++, ptr_node++)
+		set_center_mirror(mirror, from,
+				  packed_get_point(level->array,
+						   (*ptr_node)->element),
+				  UNIT_VECTOR_AT(level->units,
+						 (*ptr_node)->element));
+}
+
 static int __packed_k_center_true_add(Packed_level * level, unsigned int element,
 				 unsigned int level_index)
 {
 	unsigned int i;
 	double tmp, radius = level->radius[level_index];
-	unsigned int center;
 	struct lookup_table *lookup = &(level->lookup);
-	struct lookup_node **ptr_node;
-	i = 0;
+	struct center_mirror *mirror = level->mirrors + level_index;
 	if (is_marked_element_lookup(lookup, element))
 		radius = radius / 2;
-	ptr_node = lookup->lookup_table + lookup->k * level_index;
-	while (i < lookup->k && *ptr_node) {
-		center = (*ptr_node)->element;
-		tmp = packed_distance(level->array + element,
-				      level->array + center);
-		if (radius >= tmp) {
-			connect_element_lookup(lookup, element, level_index, i);
-			return 0;
-		}
-		i++;
-		ptr_node++;
-	}
+	i = first_center_within_mirror(mirror,
+				       packed_get_point(level->array, element),
+				       UNIT_VECTOR_AT(level->units, element),
+				       radius, &tmp);
 	connect_element_lookup(lookup, element, level_index, i);
+	if (i < mirror->nb)
+		return 0;
+	if (i < lookup->k)
+		packed_sync_mirror(level, level_index, i);
 	return 1;
 }
 
@@ -145,6 +177,8 @@ packed_k_center_delete(Packed_level * level, unsigned int element_index,
 	unsigned int size, i;
 	if (remove_element_lookup(&(level->lookup),
 				  element_index, helper_array, &size)) {
+		for (i = 0; i < level->lookup.nb_level; i++)
+			packed_sync_mirror(level, i, 0);
 		shuffle_array(helper_array, size);
 		for (i = 0; i < size; i++) {
 			__packed_k_center_add(level, helper_array[i]);
@@ -152,31 +186,38 @@ packed_k_center_delete(Packed_level * level, unsigned int element_index,
 	}
 }
 
-double packed_compute_radius_cluster(struct lookup_node *node,void *point_array, void *center){
+double packed_compute_radius_cluster(struct lookup_node *node,void *point_array, Unit_vector *units, unsigned int center){
 	double radius=0;
-	struct lookup_node *tmp;
-	if(is_leaf_lookup(node)){
-		if( center == point_array + node->element)
-			return 0;
-		return packed_distance(center,point_array+node->element);
-	}
-	for(tmp=node->first_child; NULL != tmp; tmp=tmp->next)
-		radius=MAX(radius,packed_compute_radius_cluster(tmp,point_array,center));
+	struct lookup_node *leaf;
+	for (leaf = first_leaf_lookup(node); NULL != leaf;
+	     leaf = next_leaf_lookup(node, leaf))
+		if (center != leaf->element)
+			radius = MAX(radius,
+				     geo_distance_unit(packed_get_point
+						       (point_array, center),
+						       UNIT_VECTOR_AT(units,
+								      center),
+						       packed_get_point
+						       (point_array,
+							leaf->element),
+						       UNIT_VECTOR_AT(units,
+								      leaf->
+								      element)));
 	return radius;
 }
 
-static double __packed_compute_true_radius(struct lookup_table * lookup, unsigned int level_index, void *array){
+static double __packed_compute_true_radius(struct lookup_table * lookup, unsigned int level_index, void *array, Unit_vector *units){
 	double radius=0;
 	struct lookup_node **tree;
 	unsigned int i;
 	for(i = 0, tree = lookup->lookup_table + lookup->k * level_index; i < lookup->k && NULL != *tree; i++, tree++)
-		radius = MAX(radius,packed_compute_radius_cluster(*tree, array, array+ (*tree)->element));
+		radius = MAX(radius,packed_compute_radius_cluster(*tree, array, units, (*tree)->element));
 	return radius;
 }
 static double packed_compute_true_radius(Packed_level * level,
 					 unsigned int level_index)
 {
-	return __packed_compute_true_radius(&(level->lookup),level_index,level->array);
+	return __packed_compute_true_radius(&(level->lookup),level_index,level->array,level->units);
 }
 
 unsigned int packed_get_number_cluster(Packed_level * level,
@@ -197,20 +238,20 @@ Error_enum packed_write_log(Packed_level levels[],
 		if (group_index == nb_groups) {
 			printf
 			    ("Error, no feasible radius possible found after inserting %u\n",
-			     query->data_index);
+			     query->id);
 			return ONLY_BAD_LEVELS_ERROR;
 		}
 		if (has_long_log()){
 			double true_radius=packed_compute_true_radius(levels + group_index,instance_index);
 			fprintf(get_log_file(), "%c %u %u c%u %lf %lf %u\n",
-				key, query->data_index, nb_points,
+				key, query->id, nb_points,
 				instance_index * nb_groups + group_index,
 				levels[group_index].radius[instance_index],true_radius,
 				packed_get_number_cluster(levels + group_index,
 							  instance_index));
 		} else {
 			fprintf(get_log_file(), "%c %u %u c%u %lf %u\n", key,
-				query->data_index, nb_points,
+				query->id, nb_points,
 				instance_index * nb_groups + group_index,
 				levels[group_index].radius[instance_index],
 				packed_get_number_cluster(levels + group_index,
@@ -250,3 +291,24 @@ packed_k_center_run(Packed_level levels[], unsigned int nb_groups,
 		packed_apply_one_query(levels, nb_groups, &query, helper_array);
 	}
 }
+
+void
+packed_k_center_stream(Packed_level levels[], unsigned int nb_groups,
+		       struct operation_stream *stream)
+{
+	struct query query;
+	unsigned int i, *helper_array = NULL;
+	while (read_operation(stream, &query)) {
+		if (NULL == helper_array || stream->range != levels->nb_points) {
+			free(helper_array);
+			helper_array = malloc_wrapper(sizeof(*helper_array) *
+						      stream->range);
+		}
+		for (i = 0; i < nb_groups; i++)
+			packed_resize_level(levels + i, stream->points,
+					    stream->units,
+					    (unsigned int)stream->range);
+		packed_apply_one_query(levels, nb_groups, &query, helper_array);
+	}
+	free(helper_array);
+}
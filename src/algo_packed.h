@@ -7,6 +7,8 @@ The module contains the code about the sliding window algorithm on GPS point
 #include "point.h"
 #include "lookup.h"
 #include "data_packed.h"
+#include "center_mirror.h"
+#include "operation_stream.h"
 
 /**
  * The following structure corresponds to a group of levels.
@@ -14,8 +16,10 @@ The module contains the code about the sliding window algorithm on GPS point
 typedef struct {
 	struct lookup_table lookup; /* The disjoint tree forest used to store the clusters */
         void *array; /* the list of all points */
+	Unit_vector *units; /* unit vector of each point of array, NULL unless the great-circle metric is used */
 	unsigned int nb_points; /* total number of points */
 	double *radius; /* An array with the radius of each level in the group */
+	struct center_mirror *mirrors; /* coordinates of the centers of each level in the group */
 } Packed_level;
 
 /**
@@ -23,19 +27,26 @@ typedef struct {
  */
 void packed_initialise_level(Packed_level * level, unsigned int k,
 			     double base_radius, unsigned int nb_level,
-			     void * point_array, unsigned int nb_points);
+			     void * point_array, Unit_vector * units,
+			     unsigned int nb_points);
+/**
+ * Let a packed level cluster the elements from 0 to nb_points - 1, whose coordinates are now in array and unit vectors in units
+ */
+void packed_resize_level(Packed_level * level, void *array,
+			 Unit_vector * units, unsigned int nb_points);
+
 /**
  * Delete a packed level
  */
 void packed_free_level(Packed_level * level);
 
 /**
- * Initialise an array of nb_instances packed levels.
+ * Initialise an array of nb_instances packed levels, units giving the unit vectors of the points with the great-circle metric and being NULL otherwise.
  */
 void packed_initialise_levels_array(Packed_level * levels[], unsigned int k,
 				    double eps, double d_min, double d_max,
 				    unsigned int *nb_instances,
-				    void * array,
+				    void * array, Unit_vector * units,
 				    unsigned int nb_points);
 
 /**
@@ -49,4 +60,10 @@ void packed_free_levels_array(Packed_level levels[],
  */
 void packed_k_center_run(Packed_level levels[], unsigned int nb_instances,
 			 struct query_provider * queries);
+
+/**
+ * Run the packed fully dynamic algorithm on the operations of a stream, the levels growing with its number of slots.
+ */
+void packed_k_center_stream(Packed_level levels[], unsigned int nb_groups,
+			    struct operation_stream *stream);
 #endif
@@ -12,35 +12,41 @@ The module contains the code about the sliding window algorithm on GPS point
 
 void
 sliding_initialise_level(Sliding_level * level, unsigned int k,
-			 double radius, void * array,
-			 unsigned int nb_points)
+			 double radius, struct sliding_window *window,
+			 int use_grid)
 {
 	unsigned int i;
 	level->attr_nb = 0;
 	level->k = k;
 	level->radius = radius;
-	level->elements = malloc_wrapper(sizeof(*level->elements) * nb_points);
+	level->elements = malloc_wrapper(sizeof(*level->elements) *
+					 SLIDING_INITIAL_ELEMENTS);
+	level->elements_mask = SLIDING_INITIAL_ELEMENTS - 1;
 	level->attr = malloc_wrapper(sizeof(*level->attr) * (k + 1));
 	level->first_attr = 0;
-	level->repr =
-	    (unsigned int *)malloc_wrapper(sizeof(unsigned int) * (k + 1));
-	level->orphans =
-	    (unsigned int *)malloc_wrapper(sizeof(unsigned int) * (k + 2));
-	level->parents =
-	    (unsigned int *)malloc_wrapper(sizeof(unsigned int) * (k + 2));
+	level->repr = malloc_wrapper(sizeof(*level->repr) * (k + 1));
+	level->orphans = malloc_wrapper(sizeof(*level->orphans) * (k + 2));
+	level->parents = malloc_wrapper(sizeof(*level->parents) * (k + 2));
 	for (i = 0; i < k + 2; i++) {
-		level->orphans[i] = (unsigned int)-1;
-		level->parents[i] = (unsigned int)-1;
+		level->orphans[i] = NO_STREAM_OFFSET;
+		level->parents[i] = NO_STREAM_OFFSET;
 	}
-	level->centers =
-	    (unsigned int *)malloc_wrapper(sizeof(unsigned int) * (k + 1));
+	level->centers = malloc_wrapper(sizeof(*level->centers) * (k + 1));
 	level->cluster_nb = 0;
-	level->sp_points =
-	    (unsigned int *)malloc_wrapper(sizeof(unsigned int) * (2 * k + 3));
+	level->sp_points = malloc_wrapper(sizeof(*level->sp_points) *
+					  (2 * k + 3));
 	level->first_point = 0;
 	level->last_point = 0;
-	level->nb_points = nb_points;
-	level->array = array;
+	level->window = window;
+	level->attr_grid = NULL;
+	level->centers_grid = NULL;
+	if (use_grid) {
+		level->attr_grid = malloc_wrapper(sizeof(*level->attr_grid));
+		initialise_center_grid(level->attr_grid, k + 1, radius);
+		level->centers_grid =
+		    malloc_wrapper(sizeof(*level->centers_grid));
+		initialise_center_grid(level->centers_grid, k + 1, radius);
+	}
 }
 
 void sliding_delete_level(Sliding_level * level)
@@ -59,28 +65,36 @@ void sliding_delete_level(Sliding_level * level)
 	level->centers = NULL;
 	free(level->sp_points);
 	level->sp_points = NULL;
+	if (NULL != level->attr_grid) {
+		free_center_grid(level->attr_grid);
+		free(level->attr_grid);
+		level->attr_grid = NULL;
+		free_center_grid(level->centers_grid);
+		free(level->centers_grid);
+		level->centers_grid = NULL;
+	}
 }
 
 static void remove_expired_orphans(Sliding_level * level,
-				   unsigned int first_point)
+				   Stream_offset first_point)
 {
 	unsigned int i;
 	for (i = 0; i < level->k + 2; i++) {
-		if ((unsigned int)-1 != level->orphans[i]
+		if (NO_STREAM_OFFSET != level->orphans[i]
 		    && level->orphans[i] < first_point) {
-			level->orphans[i] = (unsigned int)-1;
-			level->parents[i] = (unsigned int)-1;
+			level->orphans[i] = NO_STREAM_OFFSET;
+			level->parents[i] = NO_STREAM_OFFSET;
 		}
 	}
 }
 
 static void create_orphan_simple(Sliding_level * level,
-				 unsigned int parent, unsigned int orphan)
+				 Stream_offset parent, Stream_offset orphan)
 {
 	unsigned int i;
 	if (parent != orphan) {
 		for (i = 0; i < level->k + 2; i++)
-			if ((unsigned int)-1 == level->orphans[i]) {
+			if (NO_STREAM_OFFSET == level->orphans[i]) {
 				level->orphans[i] = orphan;
 				level->parents[i] = parent;
 				return;
@@ -91,19 +105,19 @@ static void create_orphan_simple(Sliding_level * level,
 }
 
 static void create_orphan_complex(Sliding_level * level,
-				  unsigned int parent, unsigned int orphan)
+				  Stream_offset parent, Stream_offset orphan)
 {
 	unsigned int i;
 	if (parent != orphan) {
 		for (i = 0; i < level->k + 2; i++)
-			if ((unsigned int)-1 == level->orphans[i]) {
+			if (NO_STREAM_OFFSET == level->orphans[i]) {
 				level->orphans[i] = orphan;
 				level->parents[i] = parent;
 				return;
 			}
 		remove_expired_orphans(level, level->attr[level->first_attr]);
 		for (i = 0; i < level->k + 2; i++)
-			if ((unsigned int)-1 == level->orphans[i]) {
+			if (NO_STREAM_OFFSET == level->orphans[i]) {
 				level->orphans[i] = orphan;
 				level->parents[i] = parent;
 				return;
@@ -115,13 +129,15 @@ static void create_orphan_complex(Sliding_level * level,
 
 static void remove_expired_attraction(Sliding_level * level)
 {
-	unsigned int orphan, parent;
+	Stream_offset orphan, parent;
 	while (level->attr_nb
 	       && level->attr[level->first_attr] < level->first_point) {
 		orphan = level->repr[level->first_attr];
 		parent = level->attr[level->first_attr];
-		level->attr[level->first_attr] = (unsigned int)-1;
-		level->repr[level->first_attr] = (unsigned int)-1;
+		if (NULL != level->attr_grid)
+			remove_center_grid(level->attr_grid, level->first_attr);
+		level->attr[level->first_attr] = NO_STREAM_OFFSET;
+		level->repr[level->first_attr] = NO_STREAM_OFFSET;
 		level->first_attr = (level->first_attr + 1) % (level->k + 1);
 		(level->attr_nb)--;
 		if (orphan >= level->first_point)
@@ -129,17 +145,21 @@ static void remove_expired_attraction(Sliding_level * level)
 	}
 }
 
-static void remove_expired_points(Sliding_level * level, unsigned int exp_date)
+static void remove_expired_points(Sliding_level * level,
+				  Stream_offset exp_date)
 {
 	remove_expired_orphans(level, exp_date);
 	remove_expired_attraction(level);
 }
 
-static void add_cluster(Sliding_level * level, unsigned int element)
+static void add_cluster(Sliding_level * level, Stream_offset element)
 {
+	unsigned int index;
 	if (level->attr_nb > level->k) {
-		unsigned int orphan = level->repr[level->first_attr];
-		unsigned int parent = level->attr[level->first_attr];
+		Stream_offset orphan = level->repr[level->first_attr];
+		Stream_offset parent = level->attr[level->first_attr];
+		if (NULL != level->attr_grid)
+			remove_center_grid(level->attr_grid, level->first_attr);
 		level->first_attr = (level->first_attr + 1) % (level->k + 1);
 		(level->attr_nb)--;
 		create_orphan_complex(level, parent, orphan);
@@ -147,31 +167,52 @@ static void add_cluster(Sliding_level * level, unsigned int element)
 	if (level->attr_nb > level->k - 1) {
 		remove_expired_orphans(level, level->attr[level->first_attr]);
 	}
-	level->elements[element] = element;
-	level->attr[(level->first_attr + level->attr_nb) %
-		    (level->k + 1)] = element;
-	level->repr[(level->first_attr + level->attr_nb) %
-		    (level->k + 1)] = element;
+	level->elements[element & level->elements_mask] = element;
+	index = (level->first_attr + level->attr_nb) % (level->k + 1);
+	level->attr[index] = element;
+	level->repr[index] = element;
+	if (NULL != level->attr_grid)
+		insert_center_grid(level->attr_grid, index,
+				   &(sliding_get_point(level->window, element)->
+				     point), sliding_get_unit(level->window,
+							      element));
 	level->attr_nb++;
 	assert(level->attr_nb <= level->k + 1);
 }
 
 static int
-__compute_centers(Sliding_level * level, unsigned int element,
+__compute_centers(Sliding_level * level, Stream_offset element,
 		  unsigned int elm_index)
 {
 	unsigned int i;
 	double tmp;
-	for (i = 0; i < level->cluster_nb; i++) {
-		tmp = sliding_distance(level->array+element,
-				     level->array+level->centers[i]);
-		if (level->radius >= tmp) {
+	Timestamped_point *point = sliding_get_point(level->window, element);
+	if (NULL != level->centers_grid
+	    && level->cluster_nb >= CENTER_GRID_MIN_CENTERS) {
+		i = first_center_within_grid(level->centers_grid,
+					     &(point->point),
+					     sliding_get_unit(level->window,
+							      element),
+					     level->radius, &tmp);
+		if (i < level->cluster_nb) {
 			level->sp_points[elm_index] = level->centers[i];
 			return 0;
 		}
-	}
+	} else
+		for (i = 0; i < level->cluster_nb; i++) {
+			tmp = sliding_window_distance(level->window, element,
+						      level->centers[i]);
+			if (level->radius >= tmp) {
+				level->sp_points[elm_index] = level->centers[i];
+				return 0;
+			}
+		}
 	if (level->cluster_nb == level->k)
 		return 1;
+	if (NULL != level->centers_grid)
+		insert_center_grid(level->centers_grid, level->cluster_nb,
+				   &(point->point),
+				   sliding_get_unit(level->window, element));
 	level->centers[level->cluster_nb] = element;
 	level->cluster_nb++;
 	level->sp_points[elm_index] = element;
@@ -183,17 +224,27 @@ void sliding_compute_centers(Sliding_level * level)
 	unsigned int i;
 	unsigned int index;
 	level->cluster_nb = 0;
+	if (NULL != level->centers_grid)
+		truncate_center_grid(level->centers_grid, 0);
 	if (level->attr_nb > level->k) {
 		return;
 	}
 	for (i = 0, index = level->first_attr; i < level->attr_nb;
 	     i++, index = (index + 1) % (level->k + 1)) {
+		if (NULL != level->centers_grid)
+			insert_center_grid(level->centers_grid,
+					   level->cluster_nb,
+					   &(sliding_get_point
+					     (level->window,
+					      level->attr[index])->point),
+					   sliding_get_unit(level->window,
+							    level->attr[index]));
 		level->centers[level->cluster_nb] = level->attr[index];
 		level->cluster_nb++;
 		level->sp_points[index] = level->attr[index];
 	}
 	for (i = 0; i < level->k + 2; i++) {
-		if ((unsigned int)-1 != level->orphans[i])
+		if (NO_STREAM_OFFSET != level->orphans[i])
 			if (__compute_centers
 			    (level, level->orphans[i], i + level->k + 1)) {
 				level->centers[level->cluster_nb] =
@@ -204,52 +255,82 @@ void sliding_compute_centers(Sliding_level * level)
 	}
 }
 
-void sliding_k_center_add(Sliding_level * level, unsigned int element)
+/**
+ * @grow_elements : double the size of the ring of ancestors of @level
+ */
+static void grow_elements(Sliding_level * level)
+{
+	Stream_offset i, mask = 2 * level->elements_mask + 1;
+	Stream_offset *elements = malloc_wrapper(sizeof(*elements) * (mask + 1));
+	for (i = level->first_point; i < level->last_point; i++)
+		elements[i & mask] = level->elements[i & level->elements_mask];
+	free(level->elements);
+	level->elements = elements;
+	level->elements_mask = mask;
+}
+
+void sliding_k_center_add(Sliding_level * level, Stream_offset element)
 {
 	unsigned int i, i_min, index, flag = 0;
 	double d_min, tmp;
-	Timestamped_point *array=array;
-	level->last_point = element + 1;
+	Timestamped_point *point = sliding_get_point(level->window, element);
 	for (;
 	     level->first_point <= element
-	     && array[element].in_date >=
-	     array[level->first_point].exp_date;
+	     && point->in_date >=
+	     sliding_get_point(level->window, level->first_point)->exp_date;
 	     (level->first_point)++) ;
+	if (element - level->first_point > level->elements_mask)
+		grow_elements(level);
+	level->last_point = element + 1;
 	remove_expired_points(level, level->first_point);
-	for (i = 0, index = level->first_attr; i < level->attr_nb;
-	     i++, index = (index + 1) % (level->k + 1)) {
-		tmp =
-		    sliding_distance(array + element,
-				     array + level->attr[index]);
-		if (level->radius >= tmp) {
-			if (!flag) {
-				flag = 1;
-				d_min = tmp;
-				i_min = index;
-			} else if (d_min > tmp) {
-				d_min = tmp;
-				i_min = index;
+	if (NULL != level->attr_grid
+	    && level->attr_nb >= CENTER_GRID_MIN_CENTERS) {
+		i_min = closest_center_within_grid(level->attr_grid,
+						   &(point->point),
+						   sliding_get_unit(level->window,
+								    element),
+						   level->radius,
+						   level->first_attr, &d_min);
+		flag = (unsigned int)-1 != i_min;
+	} else {
+		for (i = 0, index = level->first_attr; i < level->attr_nb;
+		     i++, index = (index + 1) % (level->k + 1)) {
+			tmp =
+			    sliding_window_distance(level->window, element,
+						    level->attr[index]);
+			if (level->radius >= tmp) {
+				if (!flag) {
+					flag = 1;
+					d_min = tmp;
+					i_min = index;
+				} else if (d_min > tmp) {
+					d_min = tmp;
+					i_min = index;
+				}
 			}
 		}
 	}
 	if (!flag) {
 		add_cluster(level, element);
 	} else {
-		level->elements[element] = level->attr[i_min];
+		level->elements[element & level->elements_mask] =
+		    level->attr[i_min];
 		level->repr[i_min] = element;
 	}
 }
 
-unsigned int sliding_find_cluster(Sliding_level * level, unsigned int element)
+unsigned int sliding_find_cluster(Sliding_level * level,
+				  Stream_offset element)
 {
-	unsigned int parent = level->elements[element], center;
+	Stream_offset parent =
+	    level->elements[element & level->elements_mask], center;
 	unsigned int i, j;
 	for (i = 0; i < level->cluster_nb; i++) {
 		if (parent == level->centers[i])
 			return i;
 	}
 	for (i = 0; i < level->k + 2; i++) {
-		if (level->orphans[i] != (unsigned int)-1
+		if (level->orphans[i] != NO_STREAM_OFFSET
 		    && level->parents[i] == parent) {
 			center = level->sp_points[level->k + 1 + i];
 			for (j = 0; j < level->cluster_nb; j++)
@@ -264,18 +345,18 @@ unsigned int sliding_find_cluster(Sliding_level * level, unsigned int element)
 void sliding_initialise_levels_array(Sliding_level * levels[], unsigned int k,
 				     double eps, double d_min, double d_max,
 				     unsigned int *nb_instances,
-				     void * array,
-				     unsigned int nb_points)
+				     struct sliding_window *window,
+				     int use_grid)
 {
 	unsigned int i;
 	unsigned int tmp = (unsigned int)(1 + ceil(log(d_max / d_min) /
 						   log(1 + eps)));
 	*nb_instances = tmp;
 	*levels = (Sliding_level *) malloc_wrapper(sizeof(**levels) * tmp);
-	sliding_initialise_level(*levels, k, 0, array, nb_points);
+	sliding_initialise_level(*levels, k, 0, window, use_grid);
 	for (i = 1; i < tmp; i++) {
 		sliding_initialise_level((*levels) + i, k, d_min,
-					 array, nb_points);
+					 window, use_grid);
 		d_min = (1 + eps) * d_min;
 	}
 }
@@ -304,12 +385,13 @@ sliding_get_index_smallest(Sliding_level levels[], unsigned int nb_instances)
 double sliding_compute_true_radius(Sliding_level * level)
 {
 	double true_radius = 0, tmp;
-	unsigned int i, index_cluster, index_center;
+	Stream_offset i, index_center;
+	unsigned int index_cluster;
 	for (i = level->first_point; i < level->last_point; i++) {
 		index_cluster = sliding_find_cluster(level, i);
 		index_center = level->centers[index_cluster];
-		tmp = sliding_distance(level->array + i,
-				       level->array + index_center);
+		tmp = sliding_window_distance(level->window, i,
+					      index_center);
 		if (true_radius < tmp)
 			true_radius = tmp;
 	}
@@ -317,7 +399,7 @@ double sliding_compute_true_radius(Sliding_level * level)
 }
 
 int sliding_write_log(Sliding_level levels[], unsigned int nb_instances,
-		      unsigned int element)
+		      Stream_offset element)
 {
 	if (has_log()) {
 		unsigned int result =
@@ -325,38 +407,45 @@ int sliding_write_log(Sliding_level levels[], unsigned int nb_instances,
 		if (result == nb_instances) {
 			fprintf
 			    (stderr,
-			     "Error, no feasible radius possible found after inserting %d\n",
-			     element);
+			     "Error, no feasible radius possible found after inserting %lu\n",
+			     (unsigned long)element);
 			return ONLY_BAD_LEVELS_ERROR;
 		}
 		if (has_long_log())
 			fprintf(get_log_file(),
-				"a %d %d c%d %lf %lf %d\n",
-				levels[result].last_point - 1,
-				levels[result].last_point -
-				levels[result].first_point,
+				"a %lu %lu c%d %lf %lf %d\n",
+				(unsigned long)(levels[result].last_point - 1),
+				(unsigned long)(levels[result].last_point -
+						levels[result].first_point),
 				result, levels[result].radius,
 				sliding_compute_true_radius
 				(levels + result), levels[result].cluster_nb);
 		else
-			fprintf(get_log_file(), "a %d %d c%d %lf %d\n",
-				levels[result].last_point - 1,
-				levels[result].last_point -
-				levels[result].first_point,
+			fprintf(get_log_file(), "a %lu %lu c%d %lf %d\n",
+				(unsigned long)(levels[result].last_point - 1),
+				(unsigned long)(levels[result].last_point -
+						levels[result].first_point),
 				result, levels[result].radius,
 				levels[result].cluster_nb);
 	}
 	return NO_ERROR;
 }
 
-void sliding_k_center_run(Sliding_level levels[], unsigned int nb_instances)
+void sliding_k_center_run(Sliding_level levels[], unsigned int nb_instances,
+			  struct sliding_stream *stream)
 {
-	unsigned int i, j;
-	for (i = 0; i < levels[0].nb_points; i++) {
+	Timestamped_point point;
+	Stream_offset element;
+	unsigned int j;
+	while (sliding_read_stream(stream, &point)) {
+		element = sliding_push_point(levels[0].window, &point);
 		for (j = 0; j < nb_instances; j++)
-			sliding_k_center_add(levels + j, i);
+			sliding_k_center_add(levels + j, element);
 		for (j = 0; j < nb_instances; j++)
 			sliding_compute_centers(levels + j);
-		sliding_write_log(levels, nb_instances, i);
+		sliding_write_log(levels, nb_instances, element);
+		/* every level drops the same expired points */
+		sliding_release_points(levels[0].window,
+				       levels[0].first_point);
 	}
 }
@@ -5,48 +5,66 @@ The module contains the code about the sliding window algorithm on GPS point
 #define __KCENTER_SLIDING_HEADER__
 
 #include "point.h"
+#include "center_grid.h"
+#include "data_sliding.h"
 
 #include <stdint.h>
 
+/**
+ * Initial number of elements the ring of ancestors of a level can hold, always a power of two
+ */
+#define SLIDING_INITIAL_ELEMENTS 1024
+
 typedef struct {
 	unsigned int k;		/* Maximum number of clusters allowed */
 	double radius;		/* Cluster radius */
-	unsigned int *elements;	/* the ancestor of each element */
+	Stream_offset *elements;	/* the ancestor of each element of the window, element e at index e & elements_mask */
+	Stream_offset elements_mask;	/* size of elements minus one, a power of two */
 	unsigned int attr_nb;	/* Number of attraction points */
-	unsigned int *attr;	/* index of all attraction points, looping array */
-	unsigned int *repr;	/* index of all representative points */
-	unsigned int *orphans;	/* index of all orphans */
-	unsigned int *parents;	/* index of the dead parent of each orphan */
+	Stream_offset *attr;	/* offset of all attraction points, looping array */
+	Stream_offset *repr;	/* offset of all representative points */
+	Stream_offset *orphans;	/* offset of all orphans */
+	Stream_offset *parents;	/* offset of the dead parent of each orphan */
 	unsigned int first_attr;	/* index of oldest attractor in attr */
-	unsigned int *centers;	/* index of all clusters */
+	Stream_offset *centers;	/* offset of all clusters */
 	unsigned int cluster_nb;	/* true number of cluster */
-	unsigned int *sp_points;	/* true assignment of every attractor and orphan in the clustering */
-	unsigned int first_point;	/* oldest point */
-	unsigned int last_point;	/* newest point */
-	unsigned int nb_points;	/* total number of points in array */
-	void *array;	/* pointer to all points */
+	Stream_offset *sp_points;	/* true assignment of every attractor and orphan in the clustering */
+	Stream_offset first_point;	/* oldest point */
+	Stream_offset last_point;	/* newest point */
+	struct sliding_window *window;	/* the points of the window */
+	struct center_grid *attr_grid;	/* spatial index of the attraction points by position in attr, NULL if not used */
+	struct center_grid *centers_grid;	/* spatial index of centers, NULL if not used */
 } Sliding_level;
 
 void sliding_initialise_level(Sliding_level * level, unsigned int k,
-			      double radius, void * array,
-			      unsigned int nb_points);
+			      double radius, struct sliding_window *window,
+			      int use_grid);
 
 void sliding_delete_level(Sliding_level * level);
 
-void sliding_k_center_add(Sliding_level * level, unsigned int element);
+void sliding_k_center_add(Sliding_level * level, Stream_offset element);
 
 void sliding_compute_centers(Sliding_level * level);
 
-unsigned int sliding_find_cluster(Sliding_level * level, unsigned int element);
+unsigned int sliding_find_cluster(Sliding_level * level,
+				  Stream_offset element);
 
 void sliding_initialise_levels_array(Sliding_level * levels[], unsigned int k,
 				     double eps, double d_min, double d_max,
 				     unsigned int *nb_instances,
-				     void * array,
-				     unsigned int nb_points);
+				     struct sliding_window *window,
+				     int use_grid);
 
 void sliding_delete_levels_array(Sliding_level levels[],
 				 unsigned int nb_instances);
 
-void sliding_k_center_run(Sliding_level levels[], unsigned int nb_instances);
+/**
+ * @sliding_k_center_run : add the points of @stream one after the other to the levels, writing the clustering after each of them, the points leaving the window being released
+ *
+ * @levels : the levels, sharing the same window
+ * @nb_instances : the number of levels
+ * @stream : the stream of points
+ */
+void sliding_k_center_run(Sliding_level levels[], unsigned int nb_instances,
+			  struct sliding_stream *stream);
 #endif
@@ -7,6 +7,7 @@ The module contains the code about the fully adversary algorithm on trajectories
 #include "set.h"
 #include "query.h"
 #include "algo_trajectories.h"
+#include "distance_cache.h"
 
 #include <sys/time.h>
 #include <stdint.h>
@@ -33,6 +34,7 @@ trajectories_initialise_level(Trajectory_level * level, unsigned int k,
 	level->max_trajectories_nb = nb_points;
 	level->current_trajectories_nb = 0;
 	level->trajectories = array;
+	level->hausdorff = NULL;
 }
 
 void trajectories_delete_level(Trajectory_level * level)
@@ -45,6 +47,7 @@ void trajectories_delete_level(Trajectory_level * level)
 	level->max_trajectories_nb = 0;
 	level->current_trajectories_nb = 0;
 	level->trajectories = NULL;
+	level->hausdorff = NULL;
 }
 
 void trajectories_initialise_level_array(Trajectory_level * levels[],
@@ -102,20 +105,105 @@ double trajectories_compute_true_radius(Trajectory_level * level)
 	return max_rad;
 }
 
+/**
+ * Distance between the trajectories a and b, looked up first in cache when it is not NULL.
+ */
+static double
+trajectories_cached_distance(Trajectory_level * level, unsigned int a,
+			     unsigned int b, struct distance_cache *cache)
+{
+	double tmp;
+	if (NULL != cache && get_distance_cache(cache, a, b, &tmp))
+		return tmp;
+	tmp = trajectories_distance(level->trajectories + a,
+				    level->trajectories + b);
+	if (NULL != cache)
+		store_distance_cache(cache, a, b, tmp);
+	return tmp;
+}
+
+/**
+ * Check whether the distance between the trajectories a and b is at most the radius of level, using the bounds in cache when it is not NULL.
+ */
+static int
+trajectories_cached_within(Trajectory_level * level, unsigned int a,
+			   unsigned int b, struct distance_cache *cache)
+{
+	int tmp;
+	if (NULL != cache
+	    && -1 != (tmp = check_distance_cache(cache, a, b, level->radius)))
+		return tmp;
+	tmp = trajectories_within(level->trajectories + a,
+				  level->trajectories + b, level->radius);
+	if (NULL != cache)
+		store_bound_distance_cache(cache, a, b, level->radius, tmp);
+	return tmp;
+}
+
+/**
+ * Check whether the element is still within the radius of level from its center after one of them grew. The incremental distance of level->hausdorff is used when the answer is not already in cache.
+ */
+static int
+trajectories_member_within(Trajectory_level * level, unsigned int element,
+			   unsigned int center, struct distance_cache *cache)
+{
+	int tmp;
+	double distance;
+	if (NULL != cache
+	    && -1 != (tmp =
+		      check_distance_cache(cache, element, center,
+					   level->radius)))
+		return tmp;
+	if (NULL != level->hausdorff
+	    && hausdorff_cache_distance(level->hausdorff, element, center,
+					&distance)) {
+		if (NULL != cache)
+			store_distance_cache(cache, element, center, distance);
+		return level->radius >= distance;
+	}
+	tmp = trajectories_within(level->trajectories + element,
+				  level->trajectories + center, level->radius);
+	if (NULL != cache)
+		store_bound_distance_cache(cache, element, center,
+					   level->radius, tmp);
+	return tmp;
+}
+
+/**
+ * Account for element in the true radius of the cluster cluster_index. The exact distance is only needed, thus computed, when the true radius is logged.
+ */
+static void
+trajectories_update_true_radius(Trajectory_level * level, unsigned int element,
+				unsigned int cluster_index,
+				struct distance_cache *cache)
+{
+	double tmp;
+	if (has_long_log()) {
+		if (NULL == level->hausdorff
+		    || !hausdorff_cache_distance(level->hausdorff, element,
+						 level->centers[cluster_index],
+						 &tmp))
+			tmp = trajectories_cached_distance(level, element,
+							   level->centers
+							   [cluster_index],
+							   cache);
+		level->true_rad[cluster_index] =
+		    MAX(tmp, level->true_rad[cluster_index]);
+	}
+}
+
 static void trajectories_k_center_add(Trajectory_level * level,
-				      unsigned int element)
+				      unsigned int element,
+				      struct distance_cache *cache)
 {
 	unsigned int i;
-	double tmp;
 	for (i = 0; i < level->nb; i++) {
-		if (level->radius >=
-		    (tmp =
-		     trajectories_distance(level->trajectories + element,
-					   level->trajectories +
-					   level->centers[i]))) {
+		if (trajectories_cached_within(level, element,
+					       level->centers[i], cache)) {
 			add_element_set_collection(&(level->clusters), element,
 						   i);
-			level->true_rad[i] = MAX(tmp, level->true_rad[i]);
+			trajectories_update_true_radius(level, element, i,
+							cache);
 			return;
 		}
 	}
@@ -144,39 +232,34 @@ trajectories_is_center(Trajectory_level * level, unsigned int element,
 static void
 __trajectories_update_non_center(Trajectory_level * level,
 				 unsigned int element,
-				 unsigned int cluster_index)
+				 unsigned int cluster_index,
+				 struct distance_cache *cache)
 {
-	double tmp;
 	if (cluster_index == level->k) {
 		remove_element_set(level->clusters.sets + cluster_index,
 				   element);
-		trajectories_k_center_add(level, element);
+		trajectories_k_center_add(level, element, cache);
 		return;
 	}
-	tmp =
-	    trajectories_distance(level->trajectories + element,
-				  level->trajectories +
-				  level->centers[cluster_index]);
-	if (tmp > level->radius) {
+	if (!trajectories_member_within(level, element,
+					level->centers[cluster_index], cache)) {
 		remove_element_set(level->clusters.sets + cluster_index,
 				   element);
-		trajectories_k_center_add(level, element);
+		trajectories_k_center_add(level, element, cache);
 	}
 }
 
 static unsigned int
 __trajectories_reverse_update_non_center(Trajectory_level * level,
 					 unsigned int element,
-					 unsigned int cluster_index)
+					 unsigned int cluster_index,
+					 struct distance_cache *cache)
 {
-	double tmp =
-	    trajectories_distance(level->trajectories +
-				  level->centers[cluster_index],
-				  level->trajectories + element);
-	if (tmp > level->radius) {
+	if (!trajectories_member_within(level, element,
+					level->centers[cluster_index], cache)) {
 		remove_element_set(level->clusters.sets + cluster_index,
 				   element);
-		trajectories_k_center_add(level, element);
+		trajectories_k_center_add(level, element, cache);
 		return 0;
 	}
 	return 1;
@@ -186,7 +269,8 @@ static void
 __trajectories_update_center_restart(Trajectory_level * level,
 				     unsigned int element,
 				     unsigned int cluster_index,
-				     unsigned int *helper_array)
+				     unsigned int *helper_array,
+				     struct distance_cache *cache)
 {
 	unsigned int i, size;
 	remove_element_set(level->clusters.sets + cluster_index, element);
@@ -195,57 +279,47 @@ __trajectories_update_center_restart(Trajectory_level * level,
 				      helper_array, &size);
 	shuffle_array(helper_array, size);
 	for (i = 0; i < size; i++)
-		trajectories_k_center_add(level, helper_array[i]);
-	trajectories_k_center_add(level, element);
+		trajectories_k_center_add(level, helper_array[i], cache);
+	trajectories_k_center_add(level, element, cache);
 }
 
 static unsigned int
 __trajectories_check_legit_center(Trajectory_level * level,
 				  unsigned int center_index,
-				  unsigned int cluster_index)
+				  unsigned int cluster_index,
+				  struct distance_cache *cache)
 {
 	unsigned int i;
-	double tmp;
-	for (i = 0; i < cluster_index; i++) {
-		tmp =
-		    trajectories_distance(level->trajectories + center_index,
-					  level->trajectories +
-					  level->centers[i]);
-		if (level->radius >= tmp)
+	for (i = 0; i < cluster_index; i++)
+		if (trajectories_cached_within(level, center_index,
+					       level->centers[i], cache))
 			return 0;
-	}
 	i++;
-	for (; i < level->nb; i++) {
-		tmp =
-		    trajectories_distance(level->trajectories + center_index,
-					  level->trajectories +
-					  level->centers[i]);
-		if (level->radius >= tmp)
+	for (; i < level->nb; i++)
+		if (trajectories_cached_within(level, center_index,
+					       level->centers[i], cache))
 			return 0;
-	}
 	return 1;
 }
 
 static void
 __trajectories_iterate_reverse_center_trash(Trajectory_level * level,
 					    unsigned int center_index,
-					    unsigned int cluster_index)
+					    unsigned int cluster_index,
+					    struct distance_cache *cache)
 {
 	unsigned int i, element;
 	struct set *set = level->clusters.sets + level->k;
-	double tmp;
 	for (i = 0; i < set->card;) {
-		element = set->elements[i];
-		tmp =
-		    trajectories_distance(level->trajectories + center_index,
-					  level->trajectories + element);
-		if (tmp <= level->radius) {
+		element = get_element_set(set, i);
+		if (trajectories_cached_within(level, center_index, element,
+					       cache)) {
 			remove_element_set(level->clusters.sets +
 					   level->k, element);
 			add_element_set_collection(&(level->clusters),
 						   element, cluster_index);
-			level->true_rad[cluster_index] =
-			    MAX(tmp, level->true_rad[cluster_index]);
+			trajectories_update_true_radius(level, element,
+							cluster_index, cache);
 		} else
 			i++;
 	}
@@ -254,20 +328,20 @@ __trajectories_iterate_reverse_center_trash(Trajectory_level * level,
 static void
 __trajectories_iterate_reverse_center(Trajectory_level * level,
 				      unsigned int center_index,
-				      unsigned int cluster_index)
+				      unsigned int cluster_index,
+				      struct distance_cache *cache)
 {
 	unsigned int i, old;
 	struct set *set = level->clusters.sets + cluster_index;
 	old = (unsigned int)-1;
 	for (i = 0; i < set->card;) {
-		assert(old != set->elements[i]);
-		old = set->elements[i];
+		assert(old != get_element_set(set, i));
+		old = get_element_set(set, i);
 		if (old != center_index) {
 			i += __trajectories_reverse_update_non_center(level,
-								      set->
-								      elements
-								      [i],
-								      cluster_index);
+								      old,
+								      cluster_index,
+								      cache);
 		} else
 			i++;
 	}
@@ -276,29 +350,34 @@ __trajectories_iterate_reverse_center(Trajectory_level * level,
 static void
 __trajectories_update_center(Trajectory_level * level, unsigned int index,
 			     unsigned int cluster_index,
-			     unsigned int helper_array[])
+			     unsigned int helper_array[],
+			     struct distance_cache *cache)
 {
-	if (__trajectories_check_legit_center(level, index, cluster_index)) {
+	if (__trajectories_check_legit_center
+	    (level, index, cluster_index, cache)) {
 		__trajectories_iterate_reverse_center(level, index,
-						      cluster_index);
+						      cluster_index, cache);
 		__trajectories_iterate_reverse_center_trash(level, index,
-							    cluster_index);
+							    cluster_index,
+							    cache);
 	} else
 		__trajectories_update_center_restart(level, index,
 						     cluster_index,
-						     helper_array);
+						     helper_array, cache);
 }
 
 static void
 trajectories_k_center_update(Trajectory_level * level, unsigned int index,
-			     unsigned int helper_array[])
+			     unsigned int helper_array[],
+			     struct distance_cache *cache)
 {
 	unsigned int cluster_index;
 	if (trajectories_is_center(level, index, &cluster_index))
 		__trajectories_update_center(level, index, cluster_index,
-					     helper_array);
+					     helper_array, cache);
 	else
-		__trajectories_update_non_center(level, index, cluster_index);
+		__trajectories_update_non_center(level, index, cluster_index,
+						 cache);
 }
 
 Error_enum trajectories_write_log(Trajectory_level levels[],
@@ -332,21 +411,23 @@ Error_enum trajectories_write_log(Trajectory_level levels[],
 void
 trajectories_apply_one_query(Trajectory_level levels[],
 			     unsigned int nb_instances, struct query * query,
-			     unsigned int helper_array[])
+			     unsigned int helper_array[],
+			     struct distance_cache *cache)
 {
 	unsigned int i;
 	static unsigned int nb_points = 0;
+	reset_distance_cache(cache, query->data_index);
 	if (add_point_trajectory(levels[0].trajectories + query->data_index)) {
 		query->type = UPDATE;
 		for (i = 0; i < nb_instances; i++)
 			trajectories_k_center_update(levels + i,
 						     query->data_index,
-						     helper_array);
+						     helper_array, cache);
 	} else {
 		nb_points++;
 		for (i = 0; i < nb_instances; i++)
 			trajectories_k_center_add(levels + i,
-						  query->data_index);
+						  query->data_index, cache);
 	}
 	trajectories_write_log(levels, nb_instances, nb_points, query);
 }
@@ -357,10 +438,24 @@ trajectories_k_center_run(Trajectory_level levels[],
 			  unsigned int helper_array[])
 {
 	struct query query;
+	struct distance_cache cache;
+	struct hausdorff_cache hausdorff;
+	unsigned int i;
+	initialise_distance_cache(&cache, levels[0].k * nb_instances);
+	initialise_hausdorff_cache(&hausdorff, levels[0].trajectories,
+				   levels[0].max_trajectories_nb, nb_instances);
+	for (i = 0; i < nb_instances; i++)
+		levels[i].hausdorff = &hausdorff;
 	while (get_next_query_trajectories(queries, &query)) {
 		trajectories_apply_one_query(levels, nb_instances,
-					     &query, helper_array);
+					     &query, helper_array, &cache);
 	}
+	fprintf(stderr, "distance cache: %lu hits, %lu misses\n", cache.hits,
+		cache.misses);
+	for (i = 0; i < nb_instances; i++)
+		levels[i].hausdorff = NULL;
+	free_hausdorff_cache(&hausdorff);
+	free_distance_cache(&cache);
 }
 
 struct query master_query;
@@ -440,6 +535,9 @@ void trajectories_parallel_k_center_run(struct query_provider * queries)
 	pthread_mutex_unlock(&mutex_to_do);
 }
 
+/**
+ * Levels are updated concurrently by the workers, so they share neither a distance cache nor a Hausdorff cache.
+ */
 static void
 trajectories_apply_one_query_one_level(Trajectory_level * level,
 				       struct query * query,
@@ -447,11 +545,11 @@ trajectories_apply_one_query_one_level(Trajectory_level * level,
 {
 	switch (query->type) {
 	case ADD:
-		trajectories_k_center_add(level, query->data_index);
+		trajectories_k_center_add(level, query->data_index, NULL);
 		break;
 	case UPDATE:
 		trajectories_k_center_update(level, query->data_index,
-					     helper_array);
+					     helper_array, NULL);
 		break;
 	default:
 		fprintf(stderr, "Unknown query type %d\n", query->type);
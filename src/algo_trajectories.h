@@ -8,6 +8,7 @@ The module contains the code about the fully adversary algorithm on trajectories
 #include "data_trajectories.h"
 #include "set.h"
 #include "query.h"
+#include "hausdorff_cache.h"
 
 #include <stdint.h>
 
@@ -21,6 +22,7 @@ typedef struct {
 	unsigned int max_trajectories_nb;
 	unsigned int current_trajectories_nb;
 	Trajectory *trajectories;
+	struct hausdorff_cache *hausdorff;	/* shared by all levels, NULL if not used */
 } Trajectory_level;
 
 void trajectories_initialise_level(Trajectory_level * level, unsigned int k,
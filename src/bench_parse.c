@@ -0,0 +1,101 @@
+/**
+This file contains a micro-benchmark of the parsing of coordinates, comparing the parser of the importers to strtod on the same numbers and checking that they give the same doubles.
+ **/
+
+#include "utils.h"
+#include "mapped_file.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+/**
+ * Number of coordinates parsed by default
+ */
+#define BENCH_DEFAULT_SIZE 4000000
+
+/**
+ * Longest text of a generated coordinate, separator included
+ */
+#define BENCH_NUMBER_SIZE 32
+
+/**
+ * Numbers taking the slow path or at the limits of the fast one
+ */
+static char *edge_cases[] = {
+	"0", "-0", "-0.0", "+1.5", ".5", "5.", "180", "-180.000000",
+	"0.1", "0.30000000000000004", "9007199254740992",
+	"9007199254740993", "123456789012345678901234", "1e-3", "-2.5E2",
+	"0.0000000000000000000000001", "1.7976931348623157e308",
+	"4.9e-324", "00000000000000000000000012.5", "inf", "-nan"
+};
+
+static double elapsed(struct timeval *begin, struct timeval *end)
+{
+	return (double)(end->tv_sec - begin->tv_sec) +
+	    (double)(end->tv_usec - begin->tv_usec) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int i, size = BENCH_DEFAULT_SIZE, nb_edges, mismatches = 0;
+	char *text, *fields, *cursor, *end;
+	double *expected, *parsed;
+	struct timeval begin, middle, stop;
+	size_t length;
+	if (argc > 2 || (2 == argc && (strtoui_wrapper(argv[1], &size)
+				       || 0 == size))) {
+		fprintf(stderr, "%s [nb_coordinates]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	nb_edges = sizeof(edge_cases) / sizeof(*edge_cases);
+	size += nb_edges;
+	text = malloc_wrapper((size_t)size * BENCH_NUMBER_SIZE);
+	fields = malloc_wrapper((size_t)size * BENCH_NUMBER_SIZE);
+	expected = malloc_wrapper(sizeof(*expected) * size);
+	parsed = malloc_wrapper(sizeof(*parsed) * size);
+	srand48(42);
+	for (i = 0, end = text; i < size; i++) {
+		if (i < nb_edges)
+			end += sprintf(end, "%s", edge_cases[i]);
+		else
+			end += sprintf(end, "%.6f", (drand48() - 0.5) *
+				       (i % 2 ? 180 : 360));
+		*end++ = i % 2 ? '\n' : ' ';
+	}
+	/* the importers used to give strtod the fields cut by strtok */
+	length = (size_t)(end - text);
+	for (i = 0; i < length; i++)
+		fields[i] = ' ' == text[i] || '\n' == text[i] ? '\0' : text[i];
+	gettimeofday(&begin, NULL);
+	for (i = 0, cursor = fields; i < size; i++) {
+		if (strtod_wrapper(cursor, expected + i))
+			expected[i] = 0;
+		cursor += strlen(cursor) + 1;
+	}
+	gettimeofday(&middle, NULL);
+	for (i = 0, cursor = text; i < size; i++) {
+		if (parse_double_field(&cursor, end, parsed + i))
+			parsed[i] = 0;
+		if (i % 2)
+			cursor = next_line(cursor, end);
+	}
+	gettimeofday(&stop, NULL);
+	for (i = 0; i < size; i++)
+		if (memcmp(expected + i, parsed + i, sizeof(double))
+		    && !(expected[i] != expected[i] && parsed[i] != parsed[i])) {
+			if (mismatches++ < 10)
+				fprintf(stderr, "mismatch on number %u: %.17g %.17g\n",
+					i, expected[i], parsed[i]);
+		}
+	printf("strtod: %.3fs, parse_double_field: %.3fs, speedup %.2f, %u mismatches on %u numbers\n",
+	       elapsed(&begin, &middle), elapsed(&middle, &stop),
+	       elapsed(&begin, &middle) / elapsed(&middle, &stop), mismatches,
+	       size);
+	free(text);
+	free(fields);
+	free(expected);
+	free(parsed);
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
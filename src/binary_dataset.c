@@ -0,0 +1,257 @@
+/**
+This module defines a binary columnar format for the data files, loaded without any parsing, and the functions writing it
+**/
+#include "binary_dataset.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+/**
+ * Number of values gathered before being written
+ */
+#define DATASET_BUFFER_SIZE 4096
+
+/**
+ * Size of the timestamp column of @nb points, padded to a multiple of 8 bytes
+ */
+#define TIMESTAMPS_SIZE(nb) ((((nb) * sizeof(uint32_t)) + 7) / 8 * 8)
+
+int is_dataset_file(char *path)
+{
+	char magic[sizeof(((struct dataset_header *) NULL)->magic)];
+	FILE *f = fopen_wrapper(path, "rb");
+	int tmp = sizeof(magic) == fread(magic, 1, sizeof(magic), f)
+	    && 0 == memcmp(magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+	fclose(f);
+	return tmp;
+}
+
+/**
+ * @map_dataset : map the dataset @path and check that it is a valid dataset of type @type
+ *
+ * @return NO_ERROR if it is, FILE_FORMAT_ERROR otherwise, @file being then unmapped
+ */
+static Error_enum map_dataset(struct mapped_file *file, char *path,
+			      Dataset_type type)
+{
+	struct dataset_header *header;
+	uint64_t size;
+	map_file(file, path);
+	header = (struct dataset_header *)file->data;
+	if (file->size < sizeof(*header)
+	    || memcmp(header->magic, DATASET_MAGIC, sizeof(DATASET_MAGIC))) {
+		fprintf(stderr, "%s is not a binary dataset\n", path);
+		unmap_file(file);
+		return FILE_FORMAT_ERROR;
+	}
+	if (DATASET_VERSION != header->version
+	    || DATASET_BYTE_ORDER != header->byte_order) {
+		fprintf(stderr,
+			"%s was written by another version or on another architecture\n",
+			path);
+		unmap_file(file);
+		return FILE_FORMAT_ERROR;
+	}
+	if ((uint32_t) type != header->type || header->nb_points > UINT_MAX
+	    || header->nb_trajectories > UINT_MAX) {
+		fprintf(stderr, "%s does not contain the expected data\n",
+			path);
+		unmap_file(file);
+		return FILE_FORMAT_ERROR;
+	}
+	size = sizeof(*header) + 2 * sizeof(double) * header->nb_points;
+	if (DATASET_POINTS == type)
+		size += TIMESTAMPS_SIZE(header->nb_points);
+	else
+		size += sizeof(uint64_t) * (header->nb_trajectories + 1);
+	if (size != file->size) {
+		fprintf(stderr, "%s is truncated or corrupted\n", path);
+		unmap_file(file);
+		return FILE_FORMAT_ERROR;
+	}
+	return NO_ERROR;
+}
+
+/**
+ * @load_point : set the coordinates of @point
+ */
+static void load_point(Geo_point * point, double longitude, double latitude)
+{
+	point->longitude = (Coordinate) longitude;
+	point->latitude = (Coordinate) latitude;
+}
+
+Error_enum dataset_map_points(struct mapped_file *file, char *path,
+			      double **longitude, double **latitude,
+			      uint32_t ** timestamp, unsigned int *nb_points)
+{
+	struct dataset_header *header;
+	if (map_dataset(file, path, DATASET_POINTS))
+		return FILE_FORMAT_ERROR;
+	header = (struct dataset_header *)file->data;
+	*nb_points = (unsigned int)header->nb_points;
+	*longitude = (double *)(header + 1);
+	*latitude = *longitude + *nb_points;
+	*timestamp = (uint32_t *) (*latitude + *nb_points);
+	return NO_ERROR;
+}
+
+Error_enum dataset_import_points(void **point_array, unsigned int *nb_element,
+				 char *path)
+{
+	struct mapped_file file;
+	double *longitude, *latitude;
+	uint32_t *timestamp;
+	Geo_point *points;
+	unsigned int i;
+	if (dataset_map_points(&file, path, &longitude, &latitude, &timestamp,
+			       nb_element))
+		return FILE_FORMAT_ERROR;
+	points = calloc_wrapper(MAX(*nb_element, 1), sizeof(*points));
+	for (i = 0; i < *nb_element; i++)
+		load_point(points + i, longitude[i], latitude[i]);
+	*point_array = points;
+	unmap_file(&file);
+	return NO_ERROR;
+}
+
+Error_enum dataset_import_trajectories(Trajectory ** trajectories,
+				       unsigned int *nb_element, char *path)
+{
+	struct mapped_file file;
+	struct dataset_header *header;
+	double *longitude, *latitude;
+	uint64_t *offsets;
+	Geo_point *points;
+	unsigned int i, nb_points;
+	if (map_dataset(&file, path, DATASET_TRAJECTORIES))
+		return FILE_FORMAT_ERROR;
+	header = (struct dataset_header *)file.data;
+	longitude = (double *)(header + 1);
+	latitude = longitude + header->nb_points;
+	offsets = (uint64_t *) (latitude + header->nb_points);
+	nb_points = (unsigned int)header->nb_points;
+	*nb_element = (unsigned int)header->nb_trajectories;
+	for (i = 0; i < *nb_element; i++)
+		if (offsets[i] > offsets[i + 1])
+			break;
+	if (0 != offsets[0] || i < *nb_element
+	    || nb_points != offsets[*nb_element]) {
+		fprintf(stderr, "%s has inconsistent trajectories\n", path);
+		unmap_file(&file);
+		return FILE_FORMAT_ERROR;
+	}
+	points = malloc_wrapper(MAX(nb_points, 1) * sizeof(*points));
+	for (i = 0; i < nb_points; i++)
+		load_point(points + i, longitude[i], latitude[i]);
+	*trajectories = malloc_wrapper(MAX(*nb_element, 1) *
+				       sizeof(**trajectories));
+	for (i = 0; i < *nb_element; i++) {
+		(*trajectories)[i].points = points + offsets[i];
+		(*trajectories)[i].max_length =
+		    (unsigned int)(offsets[i + 1] - offsets[i]);
+		(*trajectories)[i].current = 0;
+	}
+	trajectories_attach_units(*trajectories, *nb_element, points,
+				  nb_points);
+	unmap_file(&file);
+	return NO_ERROR;
+}
+
+/**
+ * @write_header : write the header of a dataset of type @type in @f
+ */
+static void write_header(FILE * f, Dataset_type type, unsigned int nb_points,
+			 unsigned int nb_trajectories)
+{
+	struct dataset_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+	header.version = DATASET_VERSION;
+	header.byte_order = DATASET_BYTE_ORDER;
+	header.type = (uint32_t) type;
+	header.nb_points = nb_points;
+	header.nb_trajectories = nb_trajectories;
+	fwrite(&header, sizeof(header), 1, f);
+}
+
+/**
+ * @write_coordinates : write in @f the longitudes, or latitudes if @latitude is set, of @nb points, the point i being @stride bytes after the point i - 1
+ */
+static void write_coordinates(FILE * f, Geo_point * first, size_t stride,
+			      unsigned int nb, int latitude)
+{
+	double buffer[DATASET_BUFFER_SIZE];
+	unsigned int i, j, length;
+	Geo_point *point;
+	for (i = 0; i < nb; i += length) {
+		length = MIN(nb - i, DATASET_BUFFER_SIZE);
+		for (j = 0; j < length; j++) {
+			point = (Geo_point *) ((char *)first + stride * (i + j));
+			buffer[j] = latitude ? point->latitude :
+			    point->longitude;
+		}
+		fwrite(buffer, sizeof(*buffer), length, f);
+	}
+}
+
+/**
+ * @close_dataset : close @f, reporting any error that happened while writing it
+ */
+static Error_enum close_dataset(FILE * f, char *path)
+{
+	int error = ferror(f);
+	if (fclose(f) || error) {
+		fprintf(stderr, "An error occured while writing %s\n", path);
+		return IO_ERROR;
+	}
+	return NO_ERROR;
+}
+
+Error_enum dataset_write_points(char *path, Timestamped_point * points,
+				unsigned int nb_points)
+{
+	uint32_t buffer[DATASET_BUFFER_SIZE];
+	unsigned int i, j, length;
+	size_t padding;
+	FILE *f = fopen_wrapper(path, "wb");
+	write_header(f, DATASET_POINTS, nb_points, 0);
+	write_coordinates(f, &(points->point), sizeof(*points), nb_points, 0);
+	write_coordinates(f, &(points->point), sizeof(*points), nb_points, 1);
+	for (i = 0; i < nb_points; i += length) {
+		length = MIN(nb_points - i, DATASET_BUFFER_SIZE);
+		for (j = 0; j < length; j++)
+			buffer[j] = points[i + j].in_date;
+		fwrite(buffer, sizeof(*buffer), length, f);
+	}
+	padding = TIMESTAMPS_SIZE((size_t)nb_points) -
+	    nb_points * sizeof(uint32_t);
+	memset(buffer, 0, padding);
+	fwrite(buffer, 1, padding, f);
+	return close_dataset(f, path);
+}
+
+Error_enum dataset_write_trajectories(char *path, Trajectory * trajectories,
+				      unsigned int nb_trajectories)
+{
+	unsigned int i, nb_points = 0;
+	uint64_t offset;
+	FILE *f = fopen_wrapper(path, "wb");
+	for (i = 0; i < nb_trajectories; i++)
+		nb_points += trajectories[i].max_length;
+	write_header(f, DATASET_TRAJECTORIES, nb_points, nb_trajectories);
+	for (i = 0; i < nb_trajectories; i++)
+		write_coordinates(f, trajectories[i].points, sizeof(Geo_point),
+				  trajectories[i].max_length, 0);
+	for (i = 0; i < nb_trajectories; i++)
+		write_coordinates(f, trajectories[i].points, sizeof(Geo_point),
+				  trajectories[i].max_length, 1);
+	for (i = 0, offset = 0; i <= nb_trajectories; i++) {
+		fwrite(&offset, sizeof(offset), 1, f);
+		if (i < nb_trajectories)
+			offset += trajectories[i].max_length;
+	}
+	return close_dataset(f, path);
+}
@@ -0,0 +1,139 @@
+/**
+This module defines a binary columnar format for the data files, loaded without any parsing, and the functions writing it
+**/
+#ifndef __HEADER_BINARY_DATASET
+#define __HEADER_BINARY_DATASET
+
+#include "point.h"
+#include "utils.h"
+#include "data_trajectories.h"
+#include "mapped_file.h"
+
+#include <stdint.h>
+
+/**
+ * Magic string beginning every binary dataset
+ */
+#define DATASET_MAGIC "KCDATA"
+
+/**
+ * Version of the format, increased on every incompatible change
+ */
+#define DATASET_VERSION 1
+
+/**
+ * Value stored in the header to detect files written with another byte order
+ */
+#define DATASET_BYTE_ORDER 0x01020304
+
+/**
+ * Kinds of binary datasets
+ *
+ * @DATASET_POINTS : points with a timestamp, as used by -m, -o and -s
+ * @DATASET_TRAJECTORIES : trajectories, as used by -p
+ */
+typedef enum {
+	DATASET_POINTS,
+	DATASET_TRAJECTORIES,
+	LAST_DATASET_TYPE
+} Dataset_type;
+
+/**
+ * @struct dataset_header : header of a binary dataset, followed by its columns, all in the byte order of the machine:
+ * - the longitudes of the points as doubles
+ * - the latitudes of the points as doubles
+ * - for points, their timestamps as uint32_t, padded to a multiple of 8 bytes
+ * - for trajectories, the index of the first point of each trajectory as uint64_t, followed by the number of points
+ *
+ * @magic : DATASET_MAGIC padded with zeros
+ * @version : DATASET_VERSION
+ * @byte_order : DATASET_BYTE_ORDER
+ * @type : the Dataset_type of the file
+ * @reserved : zero
+ * @nb_points : number of points
+ * @nb_trajectories : number of trajectories, zero for points
+ */
+struct dataset_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t nb_points;
+	uint64_t nb_trajectories;
+};
+
+/**
+ * @is_dataset_file : check if the file @path begins as a binary dataset
+ *
+ * @path : the path of the file
+ *
+ * @return 1 if it does, 0 otherwise
+ */
+int is_dataset_file(char *path);
+
+/**
+ * @dataset_import_points : load the points of the binary dataset @path
+ *
+ * @point_array : the array of Geo_point where points will be stored. allocated in this function, it has to be freed by the caller
+ * @nb_element : the number of points loaded
+ * @path : the path to the dataset
+ *
+ * @return NO_ERROR if no error happens and something else otherwise
+ */
+Error_enum dataset_import_points(void **point_array, unsigned int *nb_element,
+				 char *path);
+
+/**
+ * @dataset_map_points : map the binary dataset of points @path and give its columns, so that its points can be read one after the other
+ *
+ * @file : the mapping, to be unmapped with @unmap_file
+ * @path : the path to the dataset
+ * @longitude : the column of longitudes
+ * @latitude : the column of latitudes
+ * @timestamp : the column of timestamps
+ * @nb_points : the number of points
+ *
+ * @return NO_ERROR if no error happens and something else otherwise, @file being then unmapped
+ */
+Error_enum dataset_map_points(struct mapped_file *file, char *path,
+			      double **longitude, double **latitude,
+			      uint32_t ** timestamp, unsigned int *nb_points);
+
+/**
+ * @dataset_import_trajectories : load the trajectories of the binary dataset @path
+ *
+ * @trajectories : the array where trajectories will be stored, to be freed with trajectories_delete_points
+ * @nb_element : the number of trajectories loaded
+ * @path : the path to the dataset
+ *
+ * @return NO_ERROR if no error happens and something else otherwise
+ */
+Error_enum dataset_import_trajectories(Trajectory ** trajectories,
+				       unsigned int *nb_element, char *path);
+
+/**
+ * @dataset_write_points : write @points as a binary dataset in the file @path
+ *
+ * @path : the path of the file to write
+ * @points : the points to write
+ * @nb_points : their number
+ *
+ * @return NO_ERROR if no error happens and IO_ERROR otherwise
+ */
+Error_enum dataset_write_points(char *path, Timestamped_point * points,
+				unsigned int nb_points);
+
+/**
+ * @dataset_write_trajectories : write @trajectories as a binary dataset in the file @path, with all their points
+ *
+ * @path : the path of the file to write
+ * @trajectories : the trajectories to write
+ * @nb_trajectories : their number
+ *
+ * @return NO_ERROR if no error happens and IO_ERROR otherwise
+ */
+Error_enum dataset_write_trajectories(char *path, Trajectory * trajectories,
+				      unsigned int nb_trajectories);
+
+#endif
@@ -0,0 +1,253 @@
+/**
+This module contains a uniform grid indexing the centers of a level, so that looking for the centers close to a point only visits the cells around it
+**/
+#include "utils.h"
+#include "point.h"
+#include "center_grid.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#define NO_INDEX ((unsigned int)-1)
+
+/**
+ * Maximum number of cells around a point
+ */
+#define NB_NEIGHBOURS 27
+
+/**
+ * Relative slack added to the side of the cells, so that rounding can not put two points within the radius two cells apart
+ */
+#define CELL_SLACK 1e-9
+
+void initialise_center_grid(struct center_grid *grid, unsigned int capacity,
+			    double radius)
+{
+	unsigned int i, nb_buckets = 16;
+	grid->metric = get_metric();
+	if (GREAT_CIRCLE_METRIC == grid->metric)
+		grid->height = radius > 0 ? sqrt(squared_chord(radius)) :
+		    CENTER_GRID_MIN_CELL * METRES_PER_DEGREE / EARTH_RADIUS;
+	else
+		grid->height = radius > 0 ? radius : CENTER_GRID_MIN_CELL;
+	grid->height += grid->height * CELL_SLACK;
+	grid->nb_columns = (long)floor(360 / grid->height);
+	if (grid->nb_columns < 3 || GREAT_CIRCLE_METRIC == grid->metric)
+		grid->nb_columns = 1;
+	grid->width = 360 / (double)grid->nb_columns;
+	while (nb_buckets < 2 * capacity && nb_buckets < (1U << 31))
+		nb_buckets *= 2;
+	grid->mask = nb_buckets - 1;
+	grid->heads = malloc_wrapper(sizeof(*grid->heads) * nb_buckets);
+	for (i = 0; i < nb_buckets; i++)
+		grid->heads[i] = NO_INDEX;
+	grid->next = malloc_wrapper(sizeof(*grid->next) * capacity);
+	grid->previous = malloc_wrapper(sizeof(*grid->previous) * capacity);
+	grid->buckets = malloc_wrapper(sizeof(*grid->buckets) * capacity);
+	for (i = 0; i < capacity; i++)
+		grid->buckets[i] = NO_INDEX;
+	grid->points = malloc_wrapper(sizeof(*grid->points) * capacity);
+	grid->units = NULL;
+	if (GREAT_CIRCLE_METRIC == grid->metric)
+		grid->units = malloc_wrapper(sizeof(*grid->units) * capacity);
+	grid->capacity = capacity;
+	grid->end = 0;
+}
+
+void free_center_grid(struct center_grid *grid)
+{
+	free(grid->heads);
+	grid->heads = NULL;
+	free(grid->next);
+	grid->next = NULL;
+	free(grid->previous);
+	grid->previous = NULL;
+	free(grid->buckets);
+	grid->buckets = NULL;
+	free(grid->points);
+	grid->points = NULL;
+	free(grid->units);
+	grid->units = NULL;
+	grid->capacity = grid->end = 0;
+}
+
+/**
+ * @grid_cell : gives the cell of @point, a row of latitudes and a column of longitudes with the euclidean metric, a cube of the coordinates of its unit vector @unit with the great-circle metric
+ */
+static void grid_cell(struct center_grid *grid, Geo_point * point,
+		      Unit_vector * unit, long cell[])
+{
+	if (GREAT_CIRCLE_METRIC == grid->metric) {
+		cell[0] = (long)floor(unit->x / grid->height);
+		cell[1] = (long)floor(unit->y / grid->height);
+		cell[2] = (long)floor(unit->z / grid->height);
+		return;
+	}
+	cell[0] = (long)floor(point->latitude / grid->height);
+	cell[1] = (long)floor((point->longitude + 180) / grid->width) %
+	    grid->nb_columns;
+	if (cell[1] < 0)
+		cell[1] += grid->nb_columns;
+	cell[2] = 0;
+}
+
+static unsigned int grid_bucket(struct center_grid *grid, long cell[])
+{
+	unsigned long hash =
+	    (unsigned long)cell[0] * 2654435761UL ^ (unsigned long)cell[1] *
+	    40503UL ^ (unsigned long)cell[2] * 3266489917UL;
+	hash ^= hash >> 15;
+	hash *= 2246822519UL;
+	hash ^= hash >> 13;
+	return (unsigned int)hash & grid->mask;
+}
+
+void insert_center_grid(struct center_grid *grid, unsigned int index,
+			Geo_point * point, Unit_vector * unit)
+{
+	unsigned int bucket;
+	long cell[3];
+	assert(index < grid->capacity && NO_INDEX == grid->buckets[index]);
+	grid->points[index] = *point;
+	if (NULL != grid->units) {
+		if (NULL == unit)
+			compute_unit_vector(point, grid->units + index);
+		else
+			grid->units[index] = *unit;
+		unit = grid->units + index;
+	}
+	grid_cell(grid, point, unit, cell);
+	bucket = grid_bucket(grid, cell);
+	grid->buckets[index] = bucket;
+	grid->previous[index] = NO_INDEX;
+	grid->next[index] = grid->heads[bucket];
+	if (NO_INDEX != grid->heads[bucket])
+		grid->previous[grid->heads[bucket]] = index;
+	grid->heads[bucket] = index;
+	if (index >= grid->end)
+		grid->end = index + 1;
+}
+
+void remove_center_grid(struct center_grid *grid, unsigned int index)
+{
+	unsigned int bucket = grid->buckets[index];
+	if (NO_INDEX == bucket)
+		return;
+	if (NO_INDEX != grid->previous[index])
+		grid->next[grid->previous[index]] = grid->next[index];
+	else
+		grid->heads[bucket] = grid->next[index];
+	if (NO_INDEX != grid->next[index])
+		grid->previous[grid->next[index]] = grid->previous[index];
+	grid->buckets[index] = NO_INDEX;
+}
+
+void truncate_center_grid(struct center_grid *grid, unsigned int nb)
+{
+	unsigned int i;
+	for (i = nb; i < grid->end; i++)
+		remove_center_grid(grid, i);
+	if (nb < grid->end)
+		grid->end = nb;
+}
+
+/**
+ * @neighbour_buckets : gives the buckets of the 3x3 cells, or 3x3x3 cubes, around @point. A bucket may appear twice, its indices are then simply tested twice.
+ *
+ * @return the number of buckets stored in @buckets
+ */
+static unsigned int neighbour_buckets(struct center_grid *grid,
+				      Geo_point * point, Unit_vector * unit,
+				      unsigned int buckets[])
+{
+	long center[3], cell[3], i, j, l, shift, depth;
+	unsigned int nb = 0;
+	grid_cell(grid, point, unit, center);
+	depth = GREAT_CIRCLE_METRIC == grid->metric ? 1 : 0;
+	shift = depth || grid->nb_columns >= 3 ? 1 : 0;
+	for (i = -1; i <= 1; i++)
+		for (j = -shift; j <= shift; j++)
+			for (l = -depth; l <= depth; l++) {
+				cell[0] = center[0] + i;
+				cell[1] = center[1] + j;
+				if (!depth)
+					cell[1] = (cell[1] + grid->nb_columns) %
+					    grid->nb_columns;
+				cell[2] = center[2] + l;
+				buckets[nb++] = grid_bucket(grid, cell);
+			}
+	return nb;
+}
+
+/**
+ * @query_unit_vector : gives the unit vector of @point the queries of @grid need, @unit if given or else computed in @tmp, NULL with the euclidean metric
+ */
+static Unit_vector *query_unit_vector(struct center_grid *grid,
+				      Geo_point * point, Unit_vector * unit,
+				      Unit_vector * tmp)
+{
+	if (NULL == grid->units || NULL != unit)
+		return unit;
+	compute_unit_vector(point, tmp);
+	return tmp;
+}
+
+unsigned int first_center_within_grid(struct center_grid *grid,
+				      Geo_point * point, Unit_vector * unit,
+				      double radius, double *distance)
+{
+	unsigned int buckets[NB_NEIGHBOURS], nb, i, index, best = NO_INDEX;
+	double tmp;
+	Unit_vector vector;
+	unit = query_unit_vector(grid, point, unit, &vector);
+	nb = neighbour_buckets(grid, point, unit, buckets);
+	for (i = 0; i < nb; i++)
+		for (index = grid->heads[buckets[i]]; NO_INDEX != index;
+		     index = grid->next[index])
+			if (index < best
+			    && radius >= (tmp =
+					  geo_distance_unit(point, unit,
+							    grid->points +
+							    index,
+							    UNIT_VECTOR_AT
+							    (grid->units,
+							     index)))) {
+				best = index;
+				*distance = tmp;
+			}
+	return best;
+}
+
+unsigned int closest_center_within_grid(struct center_grid *grid,
+					Geo_point * point, Unit_vector * unit,
+					double radius, unsigned int first,
+					double *distance)
+{
+	unsigned int buckets[NB_NEIGHBOURS], nb, i, index, order, best = NO_INDEX,
+	    best_order = NO_INDEX;
+	double tmp, best_distance = radius;
+	Unit_vector vector;
+	unit = query_unit_vector(grid, point, unit, &vector);
+	nb = neighbour_buckets(grid, point, unit, buckets);
+	for (i = 0; i < nb; i++)
+		for (index = grid->heads[buckets[i]]; NO_INDEX != index;
+		     index = grid->next[index]) {
+			tmp = geo_distance_unit(point, unit,
+						grid->points + index,
+						UNIT_VECTOR_AT(grid->units,
+							       index));
+			if (!(best_distance >= tmp))
+				continue;
+			order = (index + grid->capacity - first) %
+			    grid->capacity;
+			if (tmp < best_distance || order < best_order) {
+				best = index;
+				best_order = order;
+				best_distance = tmp;
+			}
+		}
+	if (NO_INDEX != best)
+		*distance = best_distance;
+	return best;
+}
@@ -0,0 +1,136 @@
+/**
+This module contains a uniform grid indexing the centers of a level, so that looking for the centers close to a point only visits the cells around it
+**/
+#ifndef __HEADER_CENTER_GRID
+#define __HEADER_CENTER_GRID
+
+#include "point.h"
+
+/**
+ * Value of k from which the grid is used even if it was not asked for
+ */
+#define CENTER_GRID_MIN_K 256
+
+/**
+ * Number of centers from which looking into the grid is faster than scanning all of them
+ */
+#define CENTER_GRID_MIN_CENTERS 64
+
+/**
+ * Side of the cells used for a null radius, in degrees
+ */
+#define CENTER_GRID_MIN_CELL 1e-6
+
+/**
+ * @struct center_grid : hash table of the cells of a uniform grid whose cells are at least as large as the radius, so that every center within the radius of a point lies in one of the 3x3 cells around it. With the great-circle metric the grid splits the space around the unit sphere in cubes at least as large as the chord of the radius, and the 3x3x3 cubes around a point are looked into.
+ *
+ * @metric : the metric in use when the grid was initialised
+ * @height : latitude side of a cell, or side of a cube
+ * @width : longitude side of a cell, 360 degrees being split in a whole number of columns
+ * @nb_columns : number of columns, 1 when there are too few of them to tell the neighbouring columns apart or with the great-circle metric
+ * @capacity : number of indices the grid can hold
+ * @end : one more than the highest index stored
+ * @mask : number of buckets minus one, the number of buckets being a power of two
+ * @heads : first index of each bucket
+ * @next : next index in the bucket of each index
+ * @previous : previous index in the bucket of each index
+ * @buckets : bucket of each index, (unsigned int)-1 if the index is not stored
+ * @points : coordinates of each index
+ * @units : unit vector of each index, NULL unless the great-circle metric is used
+ */
+struct center_grid {
+	Metric_type metric;
+	double height;
+	double width;
+	long nb_columns;
+	unsigned int capacity;
+	unsigned int end;
+	unsigned int mask;
+	unsigned int *heads;
+	unsigned int *next;
+	unsigned int *previous;
+	unsigned int *buckets;
+	Geo_point *points;
+	Unit_vector *units;
+};
+
+/**
+ * @initialise_center_grid : initialise an empty @grid for the indices below @capacity and the radius @radius
+ *
+ * @grid : the grid to initialise
+ * @capacity : the number of indices
+ * @radius : the radius of the level, longitudes are expected between -180 and 180
+ *
+ * @remark : @grid must be freed with @free_center_grid to avoid memory leaks
+ */
+void initialise_center_grid(struct center_grid *grid, unsigned int capacity,
+			    double radius);
+
+/**
+ * @free_center_grid : free @grid
+ *
+ * @grid : the grid to free
+ */
+void free_center_grid(struct center_grid *grid);
+
+/**
+ * @insert_center_grid : store @point as the coordinates of @index
+ *
+ * @grid : the grid to modify
+ * @index : the index, not already stored
+ * @point : its coordinates
+ * @unit : its unit vector, NULL to compute it if the grid needs it
+ */
+void insert_center_grid(struct center_grid *grid, unsigned int index,
+			Geo_point * point, Unit_vector * unit);
+
+/**
+ * @remove_center_grid : remove @index from @grid, if it is stored
+ *
+ * @grid : the grid to modify
+ * @index : the index to remove
+ */
+void remove_center_grid(struct center_grid *grid, unsigned int index);
+
+/**
+ * @truncate_center_grid : remove all indices greater or equal to @nb from @grid
+ *
+ * @grid : the grid to modify
+ * @nb : the number of indices to keep
+ */
+void truncate_center_grid(struct center_grid *grid, unsigned int nb);
+
+/**
+ * @first_center_within_grid : look for the lowest index of @grid whose distance to @point is at most @radius
+ *
+ * @grid : the centers to look into
+ * @point : the point to test
+ * @unit : the unit vector of @point, NULL to compute it if the grid needs it
+ * @radius : the maximum distance, at most the radius given to @initialise_center_grid
+ * @distance : the distance to the center found, untouched if there is none
+ *
+ * @return the lowest index found, (unsigned int)-1 if there is none
+ * @remark : gives exactly the result of a scan of the indices in increasing order
+ */
+unsigned int first_center_within_grid(struct center_grid *grid,
+				      Geo_point * point, Unit_vector * unit,
+				      double radius, double *distance);
+
+/**
+ * @closest_center_within_grid : look for the index of @grid closest to @point among those within @radius
+ *
+ * @grid : the centers to look into
+ * @point : the point to test
+ * @unit : the unit vector of @point, NULL to compute it if the grid needs it
+ * @radius : the maximum distance, at most the radius given to @initialise_center_grid
+ * @first : the index coming first on ties, the indices being ordered circularly from it
+ * @distance : the distance to the center found, untouched if there is none
+ *
+ * @return the index found, (unsigned int)-1 if there is none
+ * @remark : gives exactly the result of a scan of the indices in circular order from @first keeping the first closest
+ */
+unsigned int closest_center_within_grid(struct center_grid *grid,
+					Geo_point * point, Unit_vector * unit,
+					double radius, unsigned int first,
+					double *distance);
+#endif
@@ -0,0 +1,392 @@
+/**
+This module contains a structure-of-arrays copy of the coordinates of the centers of a level, and vectorised kernels looking for the first center close enough to a point
+**/
+#include "utils.h"
+#include "point.h"
+#include "center_mirror.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CENTER_MIRROR_X86
+#endif
+
+/**
+ * Relative slack added to the squared radius. The vector filter may let a few extra centers through, the exact test done afterwards on each of them removes them.
+ */
+#define SQUARED_RADIUS_SLACK 1e-12
+
+typedef unsigned int (*scan_function) (struct center_mirror *, Geo_point *,
+				       double, double, double *);
+
+typedef unsigned int (*scan_sphere_function) (struct center_mirror *,
+					      Unit_vector *, double, double,
+					      double *);
+
+static scan_function scan_centers = NULL;
+
+static scan_sphere_function scan_sphere_centers = NULL;
+
+void initialise_center_mirror(struct center_mirror *mirror, unsigned int max_nb)
+{
+	mirror->latitude = malloc_wrapper(sizeof(*mirror->latitude) * max_nb);
+	mirror->longitude = malloc_wrapper(sizeof(*mirror->longitude) * max_nb);
+	mirror->x = mirror->y = mirror->z = NULL;
+	if (GREAT_CIRCLE_METRIC == get_metric()) {
+		mirror->x = malloc_wrapper(sizeof(*mirror->x) * max_nb);
+		mirror->y = malloc_wrapper(sizeof(*mirror->y) * max_nb);
+		mirror->z = malloc_wrapper(sizeof(*mirror->z) * max_nb);
+	}
+	mirror->nb = 0;
+	mirror->max_nb = max_nb;
+}
+
+void free_center_mirror(struct center_mirror *mirror)
+{
+	free(mirror->latitude);
+	mirror->latitude = NULL;
+	free(mirror->longitude);
+	mirror->longitude = NULL;
+	free(mirror->x);
+	free(mirror->y);
+	free(mirror->z);
+	mirror->x = mirror->y = mirror->z = NULL;
+	mirror->nb = mirror->max_nb = 0;
+}
+
+void set_center_mirror(struct center_mirror *mirror, unsigned int index,
+		       Geo_point * point, Unit_vector * unit)
+{
+	Unit_vector tmp;
+	assert(index <= mirror->nb && index < mirror->max_nb);
+	mirror->latitude[index] = point->latitude;
+	mirror->longitude[index] = point->longitude;
+	if (NULL != mirror->x) {
+		if (NULL == unit) {
+			compute_unit_vector(point, &tmp);
+			unit = &tmp;
+		}
+		mirror->x[index] = unit->x;
+		mirror->y[index] = unit->y;
+		mirror->z[index] = unit->z;
+	}
+	mirror->nb = index + 1;
+}
+
+void truncate_center_mirror(struct center_mirror *mirror, unsigned int nb)
+{
+	if (nb < mirror->nb)
+		mirror->nb = nb;
+}
+
+/**
+ * @confirm_center : exact test of the center @index of @mirror, done the same way as geo_distance
+ *
+ * @return 1 if the center is within @radius of @point (its distance is then stored in @distance), 0 otherwise
+ */
+static int confirm_center(struct center_mirror *mirror, unsigned int index,
+			  Geo_point * point, double radius, double *distance)
+{
+	Geo_point center;
+	double tmp;
+	center.latitude = (Coordinate) mirror->latitude[index];
+	center.longitude = (Coordinate) mirror->longitude[index];
+	tmp = geo_distance(point, &center);
+	if (radius >= tmp) {
+		*distance = tmp;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @scan_centers_scalar : scalar scan of the centers of @mirror starting at @begin
+ */
+static unsigned int scan_centers_scalar(struct center_mirror *mirror,
+					unsigned int begin, Geo_point * point,
+					double radius, double limit,
+					double *distance)
+{
+	unsigned int i;
+	double lat, lon;
+	for (i = begin; i < mirror->nb; i++) {
+		lat = point->latitude - mirror->latitude[i];
+		lon = ABS(point->longitude - mirror->longitude[i]);
+		if (limit >= SQUARE(lat) + SQUARE(MIN(lon, 360 - lon))
+		    && confirm_center(mirror, i, point, radius, distance))
+			return i;
+	}
+	return mirror->nb;
+}
+
+static unsigned int scan_centers_generic(struct center_mirror *mirror,
+					 Geo_point * point, double radius,
+					 double limit, double *distance)
+{
+	return scan_centers_scalar(mirror, 0, point, radius, limit, distance);
+}
+
+/**
+ * @confirm_sphere_center : exact test of the center @index of @mirror with the great-circle metric, @unit being the unit vector of the point
+ *
+ * @return 1 if the center is within @radius of the point (its distance is then stored in @distance), 0 otherwise
+ * @remark : gives the same distance as geo_distance, the unit vector of the center being the one it would compute
+ */
+static int confirm_sphere_center(struct center_mirror *mirror,
+				 unsigned int index, Unit_vector * unit,
+				 double radius, double *distance)
+{
+	Unit_vector center;
+	double tmp;
+	center.x = mirror->x[index];
+	center.y = mirror->y[index];
+	center.z = mirror->z[index];
+	tmp = unit_vector_distance(unit, &center);
+	if (radius >= tmp) {
+		*distance = tmp;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @scan_sphere_scalar : scalar scan of the centers of @mirror starting at @begin, comparing to @limit their squared chords to the point of unit vector @unit
+ */
+static unsigned int scan_sphere_scalar(struct center_mirror *mirror,
+				       unsigned int begin, Unit_vector * unit,
+				       double radius, double limit,
+				       double *distance)
+{
+	unsigned int i;
+	for (i = begin; i < mirror->nb; i++)
+		if (limit >= SQUARE(unit->x - mirror->x[i]) +
+		    SQUARE(unit->y - mirror->y[i]) +
+		    SQUARE(unit->z - mirror->z[i])
+		    && confirm_sphere_center(mirror, i, unit, radius, distance))
+			return i;
+	return mirror->nb;
+}
+
+static unsigned int scan_sphere_generic(struct center_mirror *mirror,
+					Unit_vector * unit, double radius,
+					double limit, double *distance)
+{
+	return scan_sphere_scalar(mirror, 0, unit, radius, limit, distance);
+}
+
+#ifdef CENTER_MIRROR_X86
+
+__attribute__ ((target("sse2")))
+static int squared_mask_sse2(double *latitude, double *longitude,
+			     __m128d lat, __m128d lon, __m128d limit)
+{
+	__m128d d_lat, d_lon;
+	d_lat = _mm_sub_pd(lat, _mm_loadu_pd(latitude));
+	d_lon = _mm_andnot_pd(_mm_set1_pd(-0.0),
+			      _mm_sub_pd(lon, _mm_loadu_pd(longitude)));
+	d_lon = _mm_min_pd(d_lon, _mm_sub_pd(_mm_set1_pd(360), d_lon));
+	return _mm_movemask_pd(_mm_cmple_pd(_mm_add_pd(_mm_mul_pd(d_lat, d_lat),
+						       _mm_mul_pd(d_lon, d_lon)),
+					    limit));
+}
+
+/**
+ * @scan_centers_sse2 : test four centers at a time with SSE2
+ */
+__attribute__ ((target("sse2")))
+static unsigned int scan_centers_sse2(struct center_mirror *mirror,
+				      Geo_point * point, double radius,
+				      double limit, double *distance)
+{
+	__m128d lat = _mm_set1_pd(point->latitude);
+	__m128d lon = _mm_set1_pd(point->longitude);
+	__m128d vlimit = _mm_set1_pd(limit);
+	unsigned int i, mask;
+	for (i = 0; i + 4 <= mirror->nb; i += 4) {
+		mask = (unsigned int)
+		    (squared_mask_sse2(mirror->latitude + i,
+				       mirror->longitude + i, lat, lon, vlimit)
+		     | squared_mask_sse2(mirror->latitude + i + 2,
+					 mirror->longitude + i + 2, lat, lon,
+					 vlimit) << 2);
+		for (; mask; mask &= mask - 1)
+			if (confirm_center(mirror, i + (unsigned int)
+					   __builtin_ctz(mask), point, radius,
+					   distance))
+				return i + (unsigned int)__builtin_ctz(mask);
+	}
+	return scan_centers_scalar(mirror, i, point, radius, limit, distance);
+}
+
+__attribute__ ((target("avx2")))
+static int squared_mask_avx2(double *latitude, double *longitude,
+			     __m256d lat, __m256d lon, __m256d limit)
+{
+	__m256d d_lat, d_lon;
+	d_lat = _mm256_sub_pd(lat, _mm256_loadu_pd(latitude));
+	d_lon = _mm256_andnot_pd(_mm256_set1_pd(-0.0),
+				 _mm256_sub_pd(lon, _mm256_loadu_pd(longitude)));
+	d_lon = _mm256_min_pd(d_lon, _mm256_sub_pd(_mm256_set1_pd(360), d_lon));
+	return _mm256_movemask_pd(_mm256_cmp_pd
+				  (_mm256_add_pd
+				   (_mm256_mul_pd(d_lat, d_lat),
+				    _mm256_mul_pd(d_lon, d_lon)), limit,
+				   _CMP_LE_OQ));
+}
+
+/**
+ * @scan_centers_avx2 : test eight centers at a time with AVX2
+ */
+__attribute__ ((target("avx2")))
+static unsigned int scan_centers_avx2(struct center_mirror *mirror,
+				      Geo_point * point, double radius,
+				      double limit, double *distance)
+{
+	__m256d lat = _mm256_set1_pd(point->latitude);
+	__m256d lon = _mm256_set1_pd(point->longitude);
+	__m256d vlimit = _mm256_set1_pd(limit);
+	unsigned int i, mask;
+	for (i = 0; i + 8 <= mirror->nb; i += 8) {
+		mask = (unsigned int)
+		    (squared_mask_avx2(mirror->latitude + i,
+				       mirror->longitude + i, lat, lon, vlimit)
+		     | squared_mask_avx2(mirror->latitude + i + 4,
+					 mirror->longitude + i + 4, lat, lon,
+					 vlimit) << 4);
+		for (; mask; mask &= mask - 1)
+			if (confirm_center(mirror, i + (unsigned int)
+					   __builtin_ctz(mask), point, radius,
+					   distance))
+				return i + (unsigned int)__builtin_ctz(mask);
+	}
+	return scan_centers_scalar(mirror, i, point, radius, limit, distance);
+}
+
+__attribute__ ((target("sse2")))
+static int chord_mask_sse2(struct center_mirror *mirror, unsigned int i,
+			   __m128d x, __m128d y, __m128d z, __m128d limit)
+{
+	__m128d d_x, d_y, d_z;
+	d_x = _mm_sub_pd(x, _mm_loadu_pd(mirror->x + i));
+	d_y = _mm_sub_pd(y, _mm_loadu_pd(mirror->y + i));
+	d_z = _mm_sub_pd(z, _mm_loadu_pd(mirror->z + i));
+	return _mm_movemask_pd(_mm_cmple_pd
+			       (_mm_add_pd
+				(_mm_add_pd(_mm_mul_pd(d_x, d_x),
+					    _mm_mul_pd(d_y, d_y)),
+				 _mm_mul_pd(d_z, d_z)), limit));
+}
+
+/**
+ * @scan_sphere_sse2 : test four centers at a time with SSE2
+ */
+__attribute__ ((target("sse2")))
+static unsigned int scan_sphere_sse2(struct center_mirror *mirror,
+				     Unit_vector * unit, double radius,
+				     double limit, double *distance)
+{
+	__m128d x = _mm_set1_pd(unit->x);
+	__m128d y = _mm_set1_pd(unit->y);
+	__m128d z = _mm_set1_pd(unit->z);
+	__m128d vlimit = _mm_set1_pd(limit);
+	unsigned int i, mask;
+	for (i = 0; i + 4 <= mirror->nb; i += 4) {
+		mask = (unsigned int)
+		    (chord_mask_sse2(mirror, i, x, y, z, vlimit)
+		     | chord_mask_sse2(mirror, i + 2, x, y, z, vlimit) << 2);
+		for (; mask; mask &= mask - 1)
+			if (confirm_sphere_center(mirror, i + (unsigned int)
+						  __builtin_ctz(mask), unit,
+						  radius, distance))
+				return i + (unsigned int)__builtin_ctz(mask);
+	}
+	return scan_sphere_scalar(mirror, i, unit, radius, limit, distance);
+}
+
+__attribute__ ((target("avx2")))
+static int chord_mask_avx2(struct center_mirror *mirror, unsigned int i,
+			   __m256d x, __m256d y, __m256d z, __m256d limit)
+{
+	__m256d d_x, d_y, d_z;
+	d_x = _mm256_sub_pd(x, _mm256_loadu_pd(mirror->x + i));
+	d_y = _mm256_sub_pd(y, _mm256_loadu_pd(mirror->y + i));
+	d_z = _mm256_sub_pd(z, _mm256_loadu_pd(mirror->z + i));
+	return _mm256_movemask_pd(_mm256_cmp_pd
+				  (_mm256_add_pd
+				   (_mm256_add_pd
+				    (_mm256_mul_pd(d_x, d_x),
+				     _mm256_mul_pd(d_y, d_y)),
+				    _mm256_mul_pd(d_z, d_z)), limit,
+				   _CMP_LE_OQ));
+}
+
+/**
+ * @scan_sphere_avx2 : test eight centers at a time with AVX2
+ */
+__attribute__ ((target("avx2")))
+static unsigned int scan_sphere_avx2(struct center_mirror *mirror,
+				     Unit_vector * unit, double radius,
+				     double limit, double *distance)
+{
+	__m256d x = _mm256_set1_pd(unit->x);
+	__m256d y = _mm256_set1_pd(unit->y);
+	__m256d z = _mm256_set1_pd(unit->z);
+	__m256d vlimit = _mm256_set1_pd(limit);
+	unsigned int i, mask;
+	for (i = 0; i + 8 <= mirror->nb; i += 8) {
+		mask = (unsigned int)
+		    (chord_mask_avx2(mirror, i, x, y, z, vlimit)
+		     | chord_mask_avx2(mirror, i + 4, x, y, z, vlimit) << 4);
+		for (; mask; mask &= mask - 1)
+			if (confirm_sphere_center(mirror, i + (unsigned int)
+						  __builtin_ctz(mask), unit,
+						  radius, distance))
+				return i + (unsigned int)__builtin_ctz(mask);
+	}
+	return scan_sphere_scalar(mirror, i, unit, radius, limit, distance);
+}
+#endif
+
+/**
+ * @choose_scan_centers : pick the best kernels supported by the processor
+ */
+static void choose_scan_centers(void)
+{
+	scan_centers = scan_centers_generic;
+	scan_sphere_centers = scan_sphere_generic;
+#ifdef CENTER_MIRROR_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		scan_centers = scan_centers_avx2;
+		scan_sphere_centers = scan_sphere_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		scan_centers = scan_centers_sse2;
+		scan_sphere_centers = scan_sphere_sse2;
+	}
+#endif
+}
+
+unsigned int first_center_within_mirror(struct center_mirror *mirror,
+					Geo_point * point, Unit_vector * unit,
+					double radius, double *distance)
+{
+	Unit_vector tmp;
+	double limit;
+	if (NULL == scan_centers)
+		choose_scan_centers();
+	if (NULL != mirror->x) {
+		if (NULL == unit) {
+			compute_unit_vector(point, &tmp);
+			unit = &tmp;
+		}
+		limit = squared_chord(radius);
+		limit += limit * SQUARED_RADIUS_SLACK;
+		return scan_sphere_centers(mirror, unit, radius, limit,
+					   distance);
+	}
+	limit = SQUARE(radius);
+	limit += limit * SQUARED_RADIUS_SLACK;
+	return scan_centers(mirror, point, radius, limit, distance);
+}
@@ -0,0 +1,81 @@
+/**
+This module contains a structure-of-arrays copy of the coordinates of the centers of a level, and a vectorised kernel looking for the first center close enough to a point
+**/
+#ifndef __HEADER_CENTER_MIRROR
+#define __HEADER_CENTER_MIRROR
+
+#include "point.h"
+
+/**
+ * @struct center_mirror : coordinates of the centers of one level, stored as a structure of arrays.
+ *
+ * @latitude : latitude of each center
+ * @longitude : longitude of each center
+ * @x : first coordinate on the unit sphere of each center, NULL unless the great-circle metric is used, as are @y and @z, the points themselves only having their latitude and longitude
+ * @y : second coordinate on the unit sphere of each center
+ * @z : third coordinate on the unit sphere of each center
+ * @nb : number of centers currently in the mirror
+ * @max_nb : maximum number of centers the mirror can hold
+ */
+struct center_mirror {
+	double *latitude;
+	double *longitude;
+	double *x;
+	double *y;
+	double *z;
+	unsigned int nb;
+	unsigned int max_nb;
+};
+
+/**
+ * @initialise_center_mirror : initialise @mirror to hold up to @max_nb centers
+ *
+ * @mirror : the mirror to initialise
+ * @max_nb : the maximum number of centers
+ *
+ * @remark : @mirror must be freed with @free_center_mirror to avoid memory leaks
+ */
+void initialise_center_mirror(struct center_mirror *mirror, unsigned int max_nb);
+
+/**
+ * @free_center_mirror : free @mirror
+ *
+ * @mirror : the mirror to free
+ */
+void free_center_mirror(struct center_mirror *mirror);
+
+/**
+ * @set_center_mirror : store @point as the center of index @index and drop all centers after it
+ *
+ * @mirror : the mirror to modify
+ * @index : the index of the center, at most the current number of centers
+ * @point : the coordinates of the center
+ * @unit : the unit vector of the center, NULL to compute it if the mirror needs it
+ */
+void set_center_mirror(struct center_mirror *mirror, unsigned int index,
+		       Geo_point * point, Unit_vector * unit);
+
+/**
+ * @truncate_center_mirror : keep only the first @nb centers of @mirror
+ *
+ * @mirror : the mirror to modify
+ * @nb : the number of centers to keep
+ */
+void truncate_center_mirror(struct center_mirror *mirror, unsigned int nb);
+
+/**
+ * @first_center_within_mirror : look for the first center of @mirror whose distance to @point is at most @radius
+ *
+ * @mirror : the centers to scan
+ * @point : the point to test
+ * @unit : the unit vector of @point, NULL to compute it if the mirror needs it
+ * @radius : the maximum distance
+ * @distance : the distance to the center found, untouched if there is none
+ *
+ * @return the index of the first center found, the number of centers in @mirror if there is none
+ * @remark : gives exactly the result of a scan calling geo_distance on each center in turn
+ */
+unsigned int first_center_within_mirror(struct center_mirror *mirror,
+					Geo_point * point, Unit_vector * unit,
+					double radius, double *distance);
+#endif
@@ -19,16 +19,28 @@ The module contains the code about the IO operation related to the fully adversa
  */
 double fully_adv_distance(void * a, void * b);
 
+/**
+ * @fully_adv_get_point : gives the coordinates of the element of index @index in @array
+ *
+ * @array : the array of all elements
+ * @index : the index of the element
+ *
+ * @return a pointer to the coordinates of the element
+ */
+Geo_point *fully_adv_get_point(void * array, unsigned int index);
+
 /**
  * @fully_adv_import_points : imports the points in the file @path and stores them in @point_array
  *
  * @point_array : the array where points will be stored. allocated in this function, it has to be freed by the caller
  * @nb_element : the number of point imported
  * @path : the path to the file where points are stored
+ * @nb_threads : the number of threads parsing the file
  *
  * @return NO_ERROR if no error happens and something else otherwise
  */
 Error_enum fully_adv_import_points(void ** point_array,
-				   unsigned int *nb_element, char *path);
+				   unsigned int *nb_element, char *path,
+				   unsigned int nb_threads);
 
 #endif
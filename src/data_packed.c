@@ -4,6 +4,7 @@ The module contains the code about the IO operation related to the packed fully
 #define _POSIX_C_SOURCE 200112L
 #include "point.h"
 #include "data_packed.h"
+#include "mapped_file.h"
 #include "utils.h"
 
 #include <stdio.h>
@@ -15,51 +16,45 @@ The module contains the code about the IO operation related to the packed fully
 #include <sys/stat.h>
 #include <fcntl.h>
 
-#define INIT_ARRAY_SIZE 100000
-
-Error_enum packed_read_point(char *string, Geo_point * p)
+/**
+ * @packed_read_point : parse the line of index @line into the point of same index of @array
+ */
+static Error_enum packed_read_point(char **cursor, char *end, size_t line,
+				    size_t * UNUSED(item), void *array)
 {
-	char *tmp = strtok(string, "\t");
-	if (!tmp)
-		return FILE_FORMAT_ERROR;
-	tmp = strtok(NULL, " \t\n");
-	if (strtod_wrapper(tmp, &(p->longitude)))
-		return FILE_FORMAT_ERROR;
-	tmp = strtok(NULL, " \t\n");
-	if (strtod_wrapper(tmp, &(p->latitude)))
+	if (skip_field(cursor, end))
 		return FILE_FORMAT_ERROR;
-	return NO_ERROR;
+	return parse_geo_point_fields(cursor, end,
+				      packed_get_point(array, (unsigned)line));
 }
 
 Error_enum
 packed_import_points(void ** point_array,
-		     unsigned int *nb_element, char *path)
+		     unsigned int *nb_element, char *path,
+		     unsigned int nb_threads)
 {
-	char buffer[BUFSIZ];
-	unsigned line = 1;
-	size_t current = 0, max_array = INIT_ARRAY_SIZE;
-	FILE *f = fopen_wrapper(path, "r");
+	struct mapped_file file;
+	struct chunked_lines lines;
+	size_t error_line;
 	Error_enum tmp;
-	*point_array = calloc_wrapper(INIT_ARRAY_SIZE,
-					    sizeof(Geo_point));
-	while (fgets(buffer, BUFSIZ, f)) {
-		if (current == max_array)
-			*point_array = realloc_wrapper(*point_array,
-							     &max_array,
-							     sizeof
-							     (Geo_point));
-		if ((tmp = packed_read_point(buffer, *point_array + current))) {
-			fprintf(stderr,
-				"Wrong point format, incident occured line %d\n",
-				line);
-			return tmp;
-		}
-		line++;
-		current++;
+	map_file(&file, path);
+	tmp = split_lines(&lines, file.data, file.data + file.size,
+			  nb_threads, NULL, &error_line);
+	if (!tmp) {
+		*point_array = calloc_wrapper(MAX(lines.nb_lines, 1),
+					      sizeof(Geo_point));
+		tmp = parse_lines(&lines, packed_read_point, *point_array,
+				  &error_line);
 	}
-	*nb_element = (unsigned)current;
-	fclose(f);
-	return NO_ERROR;
+	if (tmp)
+		fprintf(stderr,
+			"Wrong point format, incident occured line %lu\n",
+			(unsigned long)error_line + 1);
+	else
+		*nb_element = (unsigned)lines.nb_lines;
+	free_chunked_lines(&lines);
+	unmap_file(&file);
+	return tmp;
 }
 
 void packed_print_points(void * parray, unsigned int nb_elements)
@@ -73,5 +68,10 @@ void packed_print_points(void * parray, unsigned int nb_elements)
 
 double packed_distance(void* x, void* y)
 {
-	return euclidean_distance(x,y);
+	return geo_distance(x,y);
+}
+
+Geo_point *packed_get_point(void * array, unsigned int index)
+{
+	return (Geo_point *) array + index;
 }
@@ -17,16 +17,28 @@ The module contains the code about the IO operation related to the packed fully
  */
 double packed_distance(void * a, void * b);
 
+/**
+ * @packed_get_point : gives the coordinates of the element of index @index in @array
+ *
+ * @array : the array of all elements
+ * @index : the index of the element
+ *
+ * @return a pointer to the coordinates of the element
+ */
+Geo_point *packed_get_point(void * array, unsigned int index);
+
 /**
  * @packed_import_points: imports the points in the file @path and stores them in @point_array
  *
  * @point_array : the array where points will be stored. allocated in this function, it has to be freed by the caller
  * @nb_element : the number of point imported
  * @path : the path to the file where points are stored
+ * @nb_threads : the number of threads parsing the file
  *
  * @return NO_ERROR if no error happens and something else otherwise
  */
 Error_enum packed_import_points(void ** point_array,
-				unsigned int *nb_element, char *path);
+				unsigned int *nb_element, char *path,
+				unsigned int nb_threads);
 
 #endif
@@ -1,9 +1,11 @@
 /**
 The module contains the code about the IO operation related to the sliding window algorithm on GPS point
 **/
-#define _POSIX_C_SOURCE 200112L
+#define _POSIX_C_SOURCE 200809L
 #include "point.h"
 #include "data_sliding.h"
+#include "mapped_file.h"
+#include "binary_dataset.h"
 #include "utils.h"
 
 #include <stdio.h>
@@ -15,79 +17,235 @@ The module contains the code about the IO operation related to the sliding windo
 #include <sys/stat.h>
 #include <fcntl.h>
 
-#define INIT_ARRAY_SIZE 100000
+/**
+ * @struct sliding_parse_argument : the array filled while parsing and the length of the window
+ */
+struct sliding_parse_argument {
+	Timestamped_point *array;
+	unsigned int window_length;
+};
 
-Error_enum
-sliding_read_point(char *string, Timestamped_point * p, unsigned int window_lenght)
+/**
+ * @sliding_parse_point : parse the line beginning at @cursor into @p
+ */
+static Error_enum
+sliding_parse_point(char **cursor, char *end, Timestamped_point * p,
+		    unsigned int window_length)
 {
-	char *tmp = strtok(string, "\t");
-	if (!tmp)
-		return FILE_FORMAT_ERROR;
-	if (strtoui_wrapper(tmp, &(p->in_date)))
-		return FILE_FORMAT_ERROR;
-	p->exp_date = p->in_date + window_lenght;
-	tmp = strtok(NULL, " \t\n");
-	if (strtod_wrapper(tmp, &(p->point.longitude)))
-		return FILE_FORMAT_ERROR;
-	tmp = strtok(NULL, " \t\n");
-	if (strtod_wrapper(tmp, &(p->point.latitude)))
+	if (parse_unsigned_field(cursor, end, &(p->in_date)))
 		return FILE_FORMAT_ERROR;
-	/* translate_coordinates_radian(&(p->point)); */
-	return NO_ERROR;
+	p->exp_date = p->in_date + window_length;
+	return parse_geo_point_fields(cursor, end, &(p->point));
+}
+
+/**
+ * @sliding_read_point : parse the line of index @line into the point of same index of the array of @argument
+ */
+static Error_enum
+sliding_read_point(char **cursor, char *end, size_t line,
+		   size_t * UNUSED(item), void *argument)
+{
+	struct sliding_parse_argument *parse = argument;
+	return sliding_parse_point(cursor, end, parse->array + line,
+				   parse->window_length);
 }
 
 static Error_enum
 sliding_parse_points_file(Timestamped_point ** point_array,
 			  unsigned int *nb_element, char *path,
-			  unsigned int window_length)
+			  unsigned int window_length, unsigned int nb_threads)
 {
-	char buffer[BUFSIZ];
-	unsigned line = 1;
-	size_t max_array = INIT_ARRAY_SIZE, current = 0;
-	FILE *f = fopen_wrapper(path, "r");
+	struct mapped_file file;
+	struct chunked_lines lines;
+	struct sliding_parse_argument parse;
+	size_t error_line;
 	Error_enum tmp;
-	*point_array = calloc_wrapper(INIT_ARRAY_SIZE, sizeof(**point_array));
-	while (fgets(buffer, BUFSIZ, f)) {
-		if (current == max_array)
-			*point_array = realloc_wrapper(*point_array, &max_array,
-							      sizeof(**point_array));
-		if ((tmp = sliding_read_point(buffer, *point_array + current,
-					      window_length))) {
-			fprintf(stderr,
-				"Wrong point format, incident occured line %d\n",
-				line);
-			return tmp;
-		}
-		current++;
-		line++;
+	map_file(&file, path);
+	tmp = split_lines(&lines, file.data, file.data + file.size,
+			  nb_threads, NULL, &error_line);
+	if (!tmp) {
+		*point_array = calloc_wrapper(MAX(lines.nb_lines, 1),
+					      sizeof(**point_array));
+		parse.array = *point_array;
+		parse.window_length = window_length;
+		tmp = parse_lines(&lines, sliding_read_point, &parse,
+				  &error_line);
 	}
-	*nb_element = (unsigned int)current;
-	fclose(f);
-	return NO_ERROR;
-}
-
-void sliding_print_points(void * parray, unsigned int nb_elements)
-{
-	unsigned int i;
-	Timestamped_point *array=parray;
-	for (i = 0; i < nb_elements; i++)
-		printf("%d %lf %lf\n", i, array[i].point.longitude,
-		       array[i].point.latitude);
+	if (tmp)
+		fprintf(stderr,
+			"Wrong point format, incident occured line %lu\n",
+			(unsigned long)error_line + 1);
+	else
+		*nb_element = (unsigned int)lines.nb_lines;
+	free_chunked_lines(&lines);
+	unmap_file(&file);
+	return tmp;
 }
 
-void
+Error_enum
 sliding_import_points(void ** array, unsigned int *nb_elements,
-		      char *path, unsigned int window_length)
+		      char *path, unsigned int window_length,
+		      unsigned int nb_threads)
 {
-	sliding_parse_points_file((Timestamped_point **)array, nb_elements, path, window_length);
+	return sliding_parse_points_file((Timestamped_point **)array, nb_elements,
+					 path, window_length, nb_threads);
 }
 
 double __sliding_distance(Timestamped_point * a, Timestamped_point * b)
 {
-	return euclidean_distance(&(a->point), &(b->point));
+	return geo_distance(&(a->point), &(b->point));
 }
 
 double sliding_distance(void * a, void * b)
 {
 	return __sliding_distance((Timestamped_point  *)a, (Timestamped_point *)b);
 }
+
+void sliding_initialise_window(struct sliding_window *window)
+{
+	window->points = malloc_wrapper(sizeof(*window->points) *
+					SLIDING_INITIAL_WINDOW);
+	window->units = NULL;
+	if (GREAT_CIRCLE_METRIC == get_metric())
+		window->units = malloc_wrapper(sizeof(*window->units) *
+					       SLIDING_INITIAL_WINDOW);
+	window->mask = SLIDING_INITIAL_WINDOW - 1;
+	window->first = 0;
+	window->end = 0;
+}
+
+void sliding_free_window(struct sliding_window *window)
+{
+	free(window->points);
+	window->points = NULL;
+	free(window->units);
+	window->units = NULL;
+}
+
+Stream_offset sliding_push_point(struct sliding_window *window,
+				 Timestamped_point * point)
+{
+	Timestamped_point *points;
+	Unit_vector *units;
+	Stream_offset i, mask;
+	if (window->end - window->first > window->mask) {
+		mask = 2 * window->mask + 1;
+		points = malloc_wrapper(sizeof(*points) * (mask + 1));
+		for (i = window->first; i < window->end; i++)
+			points[i & mask] = window->points[i & window->mask];
+		free(window->points);
+		window->points = points;
+		if (NULL != window->units) {
+			units = malloc_wrapper(sizeof(*units) * (mask + 1));
+			for (i = window->first; i < window->end; i++)
+				units[i & mask] =
+				    window->units[i & window->mask];
+			free(window->units);
+			window->units = units;
+		}
+		window->mask = mask;
+	}
+	window->points[window->end & window->mask] = *point;
+	if (NULL != window->units)
+		compute_unit_vector(&(point->point),
+				    window->units + (window->end & window->mask));
+	return (window->end)++;
+}
+
+void sliding_release_points(struct sliding_window *window,
+			    Stream_offset first)
+{
+	if (first > window->first)
+		window->first = MIN(first, window->end);
+}
+
+Timestamped_point *sliding_get_point(void * window, Stream_offset offset)
+{
+	struct sliding_window *w = window;
+	return w->points + (offset & w->mask);
+}
+
+Unit_vector *sliding_get_unit(struct sliding_window *window,
+			      Stream_offset offset)
+{
+	return UNIT_VECTOR_AT(window->units, offset & window->mask);
+}
+
+double sliding_window_distance(struct sliding_window *window, Stream_offset a,
+			       Stream_offset b)
+{
+	return geo_distance_unit(&(sliding_get_point(window, a)->point),
+				 sliding_get_unit(window, a),
+				 &(sliding_get_point(window, b)->point),
+				 sliding_get_unit(window, b));
+}
+
+Error_enum sliding_open_stream(struct sliding_stream *stream, char *path,
+			       unsigned int window_length)
+{
+	struct stat status;
+	stream->file = NULL;
+	stream->line = NULL;
+	stream->line_size = 0;
+	stream->nb_points = 0;
+	stream->next = 0;
+	stream->window_length = window_length;
+	stream->error = NO_ERROR;
+	if (0 == strcmp(path, "-")) {
+		stream->file = stdin;
+		return NO_ERROR;
+	}
+	/* only a regular file is peeked at, a pipe would lose its first bytes */
+	if (0 == stat(path, &status) && S_ISREG(status.st_mode)
+	    && is_dataset_file(path))
+		return dataset_map_points(&(stream->dataset), path,
+					  &(stream->longitude),
+					  &(stream->latitude),
+					  &(stream->timestamp),
+					  &(stream->nb_points));
+	stream->file = fopen_wrapper(path, "r");
+	return NO_ERROR;
+}
+
+int sliding_read_stream(struct sliding_stream *stream,
+			Timestamped_point * point)
+{
+	ssize_t length;
+	char *cursor;
+	if (NULL == stream->file) {
+		if (stream->next == stream->nb_points)
+			return 0;
+		point->in_date = stream->timestamp[stream->next];
+		point->exp_date = point->in_date + stream->window_length;
+		point->point.longitude =
+		    (Coordinate) stream->longitude[stream->next];
+		point->point.latitude =
+		    (Coordinate) stream->latitude[stream->next];
+		(stream->next)++;
+		return 1;
+	}
+	length = getline(&(stream->line), &(stream->line_size), stream->file);
+	if (-1 == length)
+		return 0;
+	cursor = stream->line;
+	if (sliding_parse_point(&cursor, stream->line + length, point,
+				stream->window_length)) {
+		fprintf(stderr,
+			"Wrong point format, incident occured line %lu\n",
+			(unsigned long)stream->next + 1);
+		stream->error = FILE_FORMAT_ERROR;
+		return 0;
+	}
+	(stream->next)++;
+	return 1;
+}
+
+void sliding_close_stream(struct sliding_stream *stream)
+{
+	if (NULL == stream->file)
+		unmap_file(&(stream->dataset));
+	else if (stdin != stream->file)
+		fclose(stream->file);
+	free(stream->line);
+	stream->line = NULL;
+}
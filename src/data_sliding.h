@@ -5,6 +5,72 @@ The module contains the code about the IO operation related to the sliding windo
 #define __HEADER_DATA_SLIDING
 
 #include "point.h"
+#include "utils.h"
+#include "mapped_file.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Offset of a point in the stream, the first point read having offset 0
+ */
+typedef uint64_t Stream_offset;
+
+/**
+ * Offset of no point
+ */
+#define NO_STREAM_OFFSET ((Stream_offset) -1)
+
+/**
+ * Initial number of points a window can hold, always a power of two
+ */
+#define SLIDING_INITIAL_WINDOW 1024
+
+/**
+ * @struct sliding_window : ring buffer holding the points of the stream that are still alive, growing with the number of such points
+ *
+ * @points : the ring, the point of offset o being stored at index o & @mask
+ * @units : the unit vectors of the points, stored as @points, NULL unless the great-circle metric is used
+ * @mask : size of the ring minus one, the size being a power of two
+ * @first : offset of the oldest point held
+ * @end : offset following the one of the newest point
+ */
+struct sliding_window {
+	Timestamped_point *points;
+	Unit_vector *units;
+	Stream_offset mask;
+	Stream_offset first;
+	Stream_offset end;
+};
+
+/**
+ * @struct sliding_stream : reader giving the points of a data file one after the other, the file being a text file, a pipe or a binary dataset
+ *
+ * @file : the text file read, NULL for a binary dataset
+ * @line : the last line read
+ * @line_size : size of the buffer of @line
+ * @dataset : the mapping of the binary dataset
+ * @longitude : column of longitudes of the binary dataset
+ * @latitude : column of latitudes of the binary dataset
+ * @timestamp : column of timestamps of the binary dataset
+ * @nb_points : number of points of the binary dataset
+ * @next : offset of the next point to read
+ * @window_length : length of the sliding window
+ * @error : NO_ERROR unless a wrong line was found
+ */
+struct sliding_stream {
+	FILE *file;
+	char *line;
+	size_t line_size;
+	struct mapped_file dataset;
+	double *longitude;
+	double *latitude;
+	uint32_t *timestamp;
+	unsigned int nb_points;
+	Stream_offset next;
+	unsigned int window_length;
+	Error_enum error;
+};
 
 /**
  * @sliding_distance : computes the distance between @a and @b
@@ -16,6 +82,106 @@ The module contains the code about the IO operation related to the sliding windo
  */
 double sliding_distance(void * a, void * b);
 
+/**
+ * @sliding_initialise_window : initialise an empty @window
+ *
+ * @window : the window to initialise
+ *
+ * @remark : @window must be freed with @sliding_free_window
+ */
+void sliding_initialise_window(struct sliding_window *window);
+
+/**
+ * @sliding_free_window : free @window
+ *
+ * @window : the window to free
+ */
+void sliding_free_window(struct sliding_window *window);
+
+/**
+ * @sliding_push_point : add a copy of @point after the newest point of @window, making the ring larger if it is full
+ *
+ * @window : the window
+ * @point : the point to add
+ *
+ * @return the offset of the point
+ */
+Stream_offset sliding_push_point(struct sliding_window *window,
+				 Timestamped_point * point);
+
+/**
+ * @sliding_release_points : forget the points of @window older than @first
+ *
+ * @window : the window
+ * @first : the offset of the oldest point still needed
+ */
+void sliding_release_points(struct sliding_window *window,
+			    Stream_offset first);
+
+/**
+ * @sliding_get_point : gives the point of offset @offset of @window
+ *
+ * @window : the window, as a struct sliding_window
+ * @offset : the offset of the point, held by @window
+ *
+ * @return a pointer to the point, valid until the next point is pushed
+ */
+Timestamped_point *sliding_get_point(void * window, Stream_offset offset);
+
+/**
+ * @sliding_window_distance : computes the distance between the points of offsets @a and @b of @window, with their unit vectors if it has them
+ *
+ * @window : the window
+ * @a : the offset of the first point, held by @window
+ * @b : the offset of the second point, held by @window
+ *
+ * @return the distance between the two points
+ */
+double sliding_window_distance(struct sliding_window *window, Stream_offset a,
+			       Stream_offset b);
+
+/**
+ * @sliding_get_unit : gives the unit vector of the point of offset @offset of @window
+ *
+ * @window : the window
+ * @offset : the offset of the point, held by @window
+ *
+ * @return a pointer to the unit vector, valid until the next point is pushed, NULL unless the great-circle metric is used
+ */
+Unit_vector *sliding_get_unit(struct sliding_window *window,
+			      Stream_offset offset);
+
+/**
+ * @sliding_open_stream : open the data file @path to read its points one after the other
+ *
+ * @stream : the stream to initialise
+ * @path : the path to the data file, - for the standard input
+ * @window_length : length of the sliding window
+ *
+ * @return NO_ERROR if no error happens and something else otherwise
+ * @remark : @stream must be closed with @sliding_close_stream
+ */
+Error_enum sliding_open_stream(struct sliding_stream *stream, char *path,
+			       unsigned int window_length);
+
+/**
+ * @sliding_read_stream : read the next point of @stream, waiting for it on a pipe
+ *
+ * @stream : the stream
+ * @point : the point read
+ *
+ * @return 1 if a point was read, 0 at the end of the stream or on a wrong line, which sets @stream->error
+ */
+int sliding_read_stream(struct sliding_stream *stream,
+			Timestamped_point * point);
+
+/**
+ * @sliding_close_stream : close @stream
+ *
+ * @stream : the stream to close
+ */
+void sliding_close_stream(struct sliding_stream *stream);
+
 /**
  * @sliding_import_points : imports the points in the file @path and stores them in @point_array
  *
@@ -23,11 +189,13 @@ double sliding_distance(void * a, void * b);
  * @nb_element : the number of point imported
  * @path : the path to the file where points are stored
  * @window_length : length of the sliding window
+ * @nb_threads : the number of threads parsing the file
  *
  * @return NO_ERROR if no error happens and something else otherwise
  */
-void sliding_import_points(void ** point_array,
-			   unsigned int *nb_element, char *path,
-			   unsigned int window_length);
+Error_enum sliding_import_points(void ** point_array,
+				 unsigned int *nb_element, char *path,
+				 unsigned int window_length,
+				 unsigned int nb_threads);
 
 #endif
@@ -5,25 +5,41 @@ This module defines the data structure used for trajectories and related functio
 #include "utils.h"
 #include "point.h"
 #include "data_trajectories.h"
+#include "mapped_file.h"
 
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+/**
+ * Relative slack removed from the great-circle bound, which is not computed the same way as the distances it bounds
+ */
+#define BOX_BOUND_SLACK 1e-9
+
+double trajectories_point_distance(Trajectory * a, unsigned int i,
+				   Trajectory * b, unsigned int j)
+{
+	return geo_distance_unit(a->points + i, UNIT_VECTOR_AT(a->units, i),
+				 b->points + j, UNIT_VECTOR_AT(b->units, j));
+}
+
 static double hausdorff_distance(Trajectory * a, Trajectory * b)
 {
 	double cmax = 0, cmin, tmp;
 	unsigned int i, j;
 	for (i = 0; i < a->current; i++) {
-		cmin = euclidean_distance(a->points + i, b->points);
+		cmin = trajectories_point_distance(a, i, b, 0);
 		for (j = 0; j < b->current; j++) {
-			tmp = euclidean_distance(a->points + i, b->points + j);
+			tmp = trajectories_point_distance(a, i, b, j);
 			if (tmp < cmax)
 				break;
 			if (tmp < cmin)
 				cmin = tmp;
 		}
+		/* a point closer than cmax to b can not change the maximum */
+		if (j < b->current)
+			continue;
 		if (cmin > cmax)
 			cmax = cmin;
 	}
@@ -35,109 +51,208 @@ double trajectories_distance(Trajectory * a, Trajectory * b)
 	return MAX(hausdorff_distance(a, b), hausdorff_distance(b, a));
 }
 
-Error_enum trajectories_read_first_line(FILE * f, char *buffer,
-					unsigned int *nb_elements,
-					unsigned int *nb_points)
+/**
+ * @hausdorff_within : check that every point of @a has a point of @b at distance at most @radius
+ */
+static int hausdorff_within(Trajectory * a, Trajectory * b, double radius)
 {
-	char *tmp;
-	if (!fgets(buffer, LIMIT_CHARACTER_LINE, f)) {
-		fprintf(stderr, "Empty file !\n");
-		return FILE_FORMAT_ERROR;
+	unsigned int i, j;
+	for (i = 0; i < a->current; i++) {
+		for (j = 0; j < b->current; j++)
+			if (radius >= trajectories_point_distance(a, i, b, j))
+				break;
+		if (j == b->current)
+			return 0;
 	}
-	tmp = strtok(buffer, " \t\n");
-	if (!tmp || strtoui_wrapper(tmp, nb_elements)) {
-		fprintf(stderr, "Wrong first line\n");
+	return 1;
+}
+
+/**
+ * @box_lower_bound : lower bound of the distance between @a and @b computed from their bounding boxes
+ *
+ * The point of @a with the lowest latitude is at least |@a->box_min.latitude - @b->box_min.latitude| away from every point of @b when it is below all of them, and symmetrically, so each side of the boxes gives a bound. Longitudes are only used when no pair of points is more than 180 degrees apart, the euclidean distance wrapping around the antimeridian otherwise.
+ * On the sphere a difference of latitudes is also a lower bound of the great-circle distance, but longitudes give none.
+ */
+static double box_lower_bound(Trajectory * a, Trajectory * b)
+{
+	double bound;
+	bound = MAX(ABS((double)a->box_min.latitude - b->box_min.latitude),
+		    ABS((double)a->box_max.latitude - b->box_max.latitude));
+	if (GREAT_CIRCLE_METRIC == get_metric())
+		return bound * METRES_PER_DEGREE * (1 - BOX_BOUND_SLACK);
+	if (180 >= (double)MAX(a->box_max.longitude, b->box_max.longitude) -
+	    MIN(a->box_min.longitude, b->box_min.longitude)) {
+		bound = MAX(bound,
+			    ABS((double)a->box_min.longitude -
+				b->box_min.longitude));
+		bound = MAX(bound,
+			    ABS((double)a->box_max.longitude -
+				b->box_max.longitude));
+	}
+	return bound;
+}
+
+int trajectories_within(Trajectory * a, Trajectory * b, double radius)
+{
+	if (a->current && b->current && radius < box_lower_bound(a, b))
+		return 0;
+	return hausdorff_within(a, b, radius) && hausdorff_within(b, a, radius);
+}
+
+static Error_enum trajectories_read_first_line(char **cursor, char *end,
+					       unsigned int *nb_elements,
+					       unsigned int *nb_points)
+{
+	if (!*cursor) {
+		fprintf(stderr, "Empty file !\n");
 		return FILE_FORMAT_ERROR;
 	}
-	tmp = strtok(NULL, " \t\n");
-	if (!tmp || strtoui_wrapper(tmp, nb_points)) {
+	if (parse_unsigned_field(cursor, end, nb_elements)
+	    || parse_unsigned_field(cursor, end, nb_points)) {
 		fprintf(stderr, "Wrong first line\n");
 		return FILE_FORMAT_ERROR;
 	}
+	*cursor = next_line(*cursor, end);
 	return NO_ERROR;
 }
 
-Error_enum read_point_trajectory(Geo_point * point)
+/**
+ * @count_trajectory : gives the number of points of the trajectory of the line
+ */
+static Error_enum count_trajectory(char **cursor, char *end,
+				   size_t *nb_points)
 {
-	char *coordinate;
-	coordinate = strtok(NULL, " \t\n,");
-	if (strtod_wrapper(coordinate, &(point->longitude)))
-		return FILE_FORMAT_ERROR;
-	coordinate = strtok(NULL, " \t\n,");
-	if (strtod_wrapper(coordinate, &(point->latitude)))
+	unsigned int length;
+	if (skip_field(cursor, end) || parse_unsigned_field(cursor, end, &length))
 		return FILE_FORMAT_ERROR;
+	*nb_points = length;
 	return NO_ERROR;
 }
 
-Error_enum read_trajectory(Trajectory * trajectory, char *buffer,
-			   Geo_point * points, unsigned int *nb_points)
+/**
+ * @struct trajectories_parse_argument : the arrays filled while parsing
+ */
+struct trajectories_parse_argument {
+	Trajectory *trajectories;
+	Geo_point *points;
+};
+
+/**
+ * @read_trajectory : parse the line of index @line into the trajectory of same index, its points being stored from the index *@nb_points
+ */
+static Error_enum read_trajectory(char **cursor, char *end, size_t line,
+				  size_t *nb_points, void *argument)
 {
+	struct trajectories_parse_argument *parse = argument;
+	Trajectory *trajectory = parse->trajectories + line;
 	unsigned int iter_points, max_length;
-	char *tmp;
-	tmp = strtok(buffer, "\t \n");
-	if (!tmp)
-		return FILE_FORMAT_ERROR;
-	tmp = strtok(NULL, " \t\n");
-	if (!tmp || strtoui_wrapper(tmp, &max_length))
+	if (skip_field(cursor, end)
+	    || parse_unsigned_field(cursor, end, &max_length))
 		return FILE_FORMAT_ERROR;
 	trajectory->current = 0;
-	trajectory->points = points + *nb_points;
+	trajectory->points = parse->points + *nb_points;
 	for (iter_points = 0; iter_points < max_length; iter_points++) {
-		if (read_point_trajectory(points + *nb_points))
+		if (parse_geo_point_fields(cursor, end,
+					   parse->points + *nb_points))
 			return FILE_FORMAT_ERROR;
 		(*nb_points)++;
 	}
 	trajectory->max_length = max_length;
-	return NO_ERROR;
+	/* more points than announced would shift all the following trajectories */
+	return check_end_of_line(cursor, end);
 }
 
 Error_enum
 trajectories_import_points(Trajectory ** trajectories,
-			   unsigned int *nb_elements, char *path)
+			   unsigned int *nb_elements, char *path,
+			   unsigned int nb_threads)
 {
-	char *buffer;
-	unsigned int current_point, current_trajectory, nb_points;
-	FILE *f = fopen_wrapper(path, "r");
-	Geo_point *points;
-	int line = 2;
-	buffer = (char *)malloc_wrapper(sizeof(char) * LIMIT_CHARACTER_LINE);
-	buffer[LIMIT_CHARACTER_LINE - 2] = '\n';
-	if (trajectories_read_first_line(f, buffer, nb_elements, &nb_points))
+	struct mapped_file file;
+	struct chunked_lines lines;
+	struct trajectories_parse_argument parse;
+	char *cursor, *end;
+	unsigned int header_elements, header_points;
+	size_t error_line;
+	Error_enum tmp;
+	parse.trajectories = NULL;
+	parse.points = NULL;
+	map_file(&file, path);
+	cursor = file.data;
+	end = file.data + file.size;
+	if (trajectories_read_first_line(&cursor, end, &header_elements,
+					 &header_points)) {
+		unmap_file(&file);
 		return FILE_FORMAT_ERROR;
-	points = (Geo_point *) malloc_wrapper(nb_points * sizeof(*points));
-	*trajectories =
-	    (Trajectory *) malloc_wrapper(*nb_elements *
-					  sizeof(**trajectories));
-	current_point = 0;
-	current_trajectory = 0;
-	while (fgets(buffer, LIMIT_CHARACTER_LINE, f)) {
-		if (buffer[LIMIT_CHARACTER_LINE - 2] != '\n') {
-			fprintf(stderr,
-				"Line longer than %d characters found\n",
-				LIMIT_CHARACTER_LINE);
-			return FILE_FORMAT_ERROR;
-		}
-		if (read_trajectory
-		    (*trajectories + current_trajectory, buffer, points,
-		     &current_point)) {
-			fprintf(stderr, "Wrong point format line %d\n", line);
-			return FILE_FORMAT_ERROR;
-		}
-		current_trajectory++;
-		line++;
 	}
-	fclose(f);
-	free(buffer);
-	return NO_ERROR;
+	tmp = split_lines(&lines, cursor, end, nb_threads, count_trajectory,
+			  &error_line);
+	if (!tmp && (header_elements != lines.nb_lines
+		     || header_points != lines.nb_items)) {
+		fprintf(stderr,
+			"The first line announces %u trajectories and %u points but the file has %lu trajectories and %lu points\n",
+			header_elements, header_points,
+			(unsigned long)lines.nb_lines,
+			(unsigned long)lines.nb_items);
+		free_chunked_lines(&lines);
+		unmap_file(&file);
+		return FILE_FORMAT_ERROR;
+	}
+	if (!tmp) {
+		/* the header, once checked, gives the exact size of the arrays */
+		parse.points = (Geo_point *)
+		    malloc_wrapper(MAX(header_points, 1) *
+				   sizeof(*parse.points));
+		parse.trajectories = (Trajectory *)
+		    malloc_wrapper(MAX(header_elements, 1) *
+				   sizeof(*parse.trajectories));
+		tmp = parse_lines(&lines, read_trajectory, &parse, &error_line);
+	}
+	if (tmp) {
+		fprintf(stderr, "Wrong point format line %lu\n",
+			(unsigned long)error_line + 2);
+		free(parse.points);
+		free(parse.trajectories);
+	} else {
+		trajectories_attach_units(parse.trajectories, header_elements,
+					  parse.points, header_points);
+		*trajectories = parse.trajectories;
+		*nb_elements = header_elements;
+	}
+	free_chunked_lines(&lines);
+	unmap_file(&file);
+	return tmp;
+}
+
+void trajectories_attach_units(Trajectory * trajectories, unsigned int nb,
+			       Geo_point * points, unsigned int nb_points)
+{
+	unsigned int i;
+	Unit_vector *units = unit_vector_array(points, nb_points);
+	for (i = 0; i < nb; i++)
+		trajectories[i].units = NULL == units ? NULL :
+		    units + (trajectories[i].points - points);
 }
 
 unsigned int add_point_trajectory(Trajectory * t)
 {
+	Geo_point *point = t->points + t->current;
+	assert(t->current < t->max_length);
+	if (0 == t->current) {
+		t->box_min = t->box_max = *point;
+	} else {
+		t->box_min.latitude = MIN(t->box_min.latitude, point->latitude);
+		t->box_min.longitude =
+		    MIN(t->box_min.longitude, point->longitude);
+		t->box_max.latitude = MAX(t->box_max.latitude, point->latitude);
+		t->box_max.longitude =
+		    MAX(t->box_max.longitude, point->longitude);
+	}
 	return (t->current)++;
 }
 
 void trajectories_delete_points(Trajectory * array)
 {
 	free(array[0].points);
+	free(array[0].units);
 	free(array);
 }
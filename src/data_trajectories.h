@@ -12,6 +12,9 @@ typedef struct {
 	unsigned int max_length;	/* maximum length of trajectory */
 	unsigned int current;	/* current number of point in trajectory */
 	Geo_point *points;	/* list of points in trajectory */
+	Unit_vector *units;	/* unit vector of each point, NULL unless the great-circle metric is used */
+	Geo_point box_min;	/* lowest coordinates of the current points */
+	Geo_point box_max;	/* highest coordinates of the current points */
 } Trajectory;
 
 /**
@@ -24,7 +27,16 @@ typedef struct {
  */
 double trajectories_distance(Trajectory * a, Trajectory * b);
 
-#define LIMIT_CHARACTER_LINE 10000000
+/**
+ * @trajectories_within : checks if the distance between @a and @b is at most @radius, stopping at the first point of either trajectory that has no point of the other within @radius
+ *
+ * @a : the first element
+ * @b : the second element
+ * @radius : the maximum distance
+ *
+ * @return 1 if trajectories_distance(@a, @b) <= @radius, 0 otherwise
+ */
+int trajectories_within(Trajectory * a, Trajectory * b, double radius);
 
 /**
  * @trajectories_import_points: imports the points in the file @path and stores them in @trajectories_array
@@ -32,13 +44,28 @@ double trajectories_distance(Trajectory * a, Trajectory * b);
  * @trajectories_array : the array where points will be stored. allocated in this function, it has to be freed by the caller
  * @nb_element : the number of point imported
  * @path : the path to the file where points are stored
+ * @nb_threads : the number of threads parsing the file
  *
  * @return NO_ERROR if no error happens and something else otherwise
  */
 Error_enum trajectories_import_points(Trajectory * trajectories_array[],
-				      unsigned int *nb_element, char *path);
+				      unsigned int *nb_element, char *path,
+				      unsigned int nb_threads);
+
+/**
+ * @trajectories_attach_units : give the @nb trajectories, whose points are the @nb_points points of @points, the unit vectors of their points when the great-circle metric is used
+ */
+void trajectories_attach_units(Trajectory * trajectories, unsigned int nb,
+			       Geo_point * points, unsigned int nb_points);
+
+/**
+ * @trajectories_point_distance : computes the distance between the point @i of @a and the point @j of @b
+ */
+double trajectories_point_distance(Trajectory * a, unsigned int i,
+				   Trajectory * b, unsigned int j);
+
 /**
-Add a point to the trajectory and return its previous size
+Add a point to the trajectory, extend its bounding box and return its previous size
 **/
 unsigned int add_point_trajectory(Trajectory * a);
 
@@ -0,0 +1,177 @@
+/**
+This module contains a cache of the distances between the element of the current query and other elements, shared by all levels
+**/
+#include "utils.h"
+#include "distance_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+void initialise_distance_cache(struct distance_cache *cache,
+			       unsigned int nb_keys)
+{
+	unsigned int size = 16;
+	while (size < 2 * nb_keys && size < (1U << 31))
+		size *= 2;
+	cache->entries = calloc_wrapper(size, sizeof(*cache->entries));
+	cache->mask = size - 1;
+	cache->generation = 1;
+	cache->nb_stored = 0;
+	cache->element = (unsigned int)-1;
+	cache->hits = cache->misses = 0;
+}
+
+void free_distance_cache(struct distance_cache *cache)
+{
+	free(cache->entries);
+	cache->entries = NULL;
+}
+
+void reset_distance_cache(struct distance_cache *cache, unsigned int element)
+{
+	cache->generation++;
+	if (0 == cache->generation) {
+		memset(cache->entries, 0,
+		       sizeof(*cache->entries) * (cache->mask + 1));
+		cache->generation = 1;
+	}
+	cache->nb_stored = 0;
+	cache->element = element;
+}
+
+/**
+ * @get_key_distance_cache : gives the key of the pair (@a, @b)
+ *
+ * @return 0 if the pair does not involve the element of the current query, 1 otherwise
+ */
+static int get_key_distance_cache(struct distance_cache *cache,
+				  unsigned int a, unsigned int b,
+				  unsigned int *key)
+{
+	if (a == cache->element)
+		*key = b;
+	else if (b == cache->element)
+		*key = a;
+	else
+		return 0;
+	return 1;
+}
+
+/**
+ * @find_entry_distance_cache : gives the entry of @key, or the empty entry where it should be stored
+ */
+static struct distance_cache_entry *find_entry_distance_cache(struct
+							      distance_cache
+							      *cache,
+							      unsigned int key)
+{
+	unsigned int position = (key * 2654435761U) & cache->mask;
+	struct distance_cache_entry *entry = cache->entries + position;
+	while (entry->generation == cache->generation && entry->key != key) {
+		position = (position + 1) & cache->mask;
+		entry = cache->entries + position;
+	}
+	return entry;
+}
+
+/**
+ * @get_entry_distance_cache : gives the entry of the pair (@a, @b), NULL if there is none
+ */
+static struct distance_cache_entry *get_entry_distance_cache(struct
+							     distance_cache
+							     *cache,
+							     unsigned int a,
+							     unsigned int b)
+{
+	unsigned int key;
+	struct distance_cache_entry *entry;
+	if (!get_key_distance_cache(cache, a, b, &key))
+		return NULL;
+	entry = find_entry_distance_cache(cache, key);
+	if (entry->generation != cache->generation)
+		return NULL;
+	return entry;
+}
+
+/**
+ * @create_entry_distance_cache : gives the entry of the pair (@a, @b), creating it if needed. NULL if the pair can not be stored.
+ */
+static struct distance_cache_entry *create_entry_distance_cache(struct
+								distance_cache
+								*cache,
+								unsigned int a,
+								unsigned int b)
+{
+	unsigned int key;
+	struct distance_cache_entry *entry;
+	if (!get_key_distance_cache(cache, a, b, &key))
+		return NULL;
+	entry = find_entry_distance_cache(cache, key);
+	if (entry->generation != cache->generation) {
+		if (2 * cache->nb_stored > cache->mask)
+			return NULL;
+		entry->generation = cache->generation;
+		entry->key = key;
+		entry->lower = -HUGE_VAL;
+		entry->upper = HUGE_VAL;
+		cache->nb_stored++;
+	}
+	return entry;
+}
+
+int get_distance_cache(struct distance_cache *cache, unsigned int a,
+		       unsigned int b, double *distance)
+{
+	struct distance_cache_entry *entry =
+	    get_entry_distance_cache(cache, a, b);
+	if (NULL == entry || entry->lower != entry->upper) {
+		cache->misses++;
+		return 0;
+	}
+	cache->hits++;
+	*distance = entry->upper;
+	return 1;
+}
+
+int check_distance_cache(struct distance_cache *cache, unsigned int a,
+			 unsigned int b, double radius)
+{
+	struct distance_cache_entry *entry =
+	    get_entry_distance_cache(cache, a, b);
+	if (NULL != entry) {
+		if (radius >= entry->upper) {
+			cache->hits++;
+			return 1;
+		}
+		if (radius < entry->lower
+		    || (radius == entry->lower && entry->lower != entry->upper)) {
+			cache->hits++;
+			return 0;
+		}
+	}
+	cache->misses++;
+	return -1;
+}
+
+void store_distance_cache(struct distance_cache *cache, unsigned int a,
+			  unsigned int b, double distance)
+{
+	struct distance_cache_entry *entry =
+	    create_entry_distance_cache(cache, a, b);
+	if (NULL != entry)
+		entry->lower = entry->upper = distance;
+}
+
+void store_bound_distance_cache(struct distance_cache *cache, unsigned int a,
+				unsigned int b, double radius, int within)
+{
+	struct distance_cache_entry *entry =
+	    create_entry_distance_cache(cache, a, b);
+	if (NULL == entry || entry->lower == entry->upper)
+		return;
+	if (within)
+		entry->upper = MIN(radius, entry->upper);
+	else
+		entry->lower = MAX(radius, entry->lower);
+}
@@ -0,0 +1,122 @@
+/**
+This module contains a cache of the distances between the element of the current query and other elements, shared by all levels
+**/
+#ifndef __HEADER_DISTANCE_CACHE
+#define __HEADER_DISTANCE_CACHE
+
+/**
+ * @struct distance_cache_entry : an entry of the distance cache
+ *
+ * @generation : generation of the entry, the entry is empty if it differs from the generation of the cache
+ * @key : the element whose distance to the element of the query is stored
+ * @lower : the distance is known to be greater than @lower, or equal to it when @lower equals @upper
+ * @upper : the distance is known to be at most @upper
+ */
+struct distance_cache_entry {
+	unsigned int generation;
+	unsigned int key;
+	double lower;
+	double upper;
+};
+
+/**
+ * @struct distance_cache : open addressing hash table of the distances, or bounds on the distances, between the element of the current query and other elements
+ *
+ * @entries : the entries of the table
+ * @mask : number of entries minus one, the number of entries being a power of two
+ * @generation : current generation, incremented to empty the table
+ * @nb_stored : number of entries stored in the current generation
+ * @element : the element of the current query
+ * @hits : number of lookups answered by the cache
+ * @misses : number of lookups not answered by the cache
+ */
+struct distance_cache {
+	struct distance_cache_entry *entries;
+	unsigned int mask;
+	unsigned int generation;
+	unsigned int nb_stored;
+	unsigned int element;
+	unsigned long hits;
+	unsigned long misses;
+};
+
+/**
+ * @initialise_distance_cache : initialise @cache
+ *
+ * @cache : the cache to initialise
+ * @nb_keys : expected number of distinct elements per query, usually the number of centers of all levels
+ *
+ * @remark : @cache must be freed with @free_distance_cache to avoid memory leaks
+ */
+void initialise_distance_cache(struct distance_cache *cache,
+			       unsigned int nb_keys);
+
+/**
+ * @free_distance_cache : free @cache
+ *
+ * @cache : the cache to free
+ */
+void free_distance_cache(struct distance_cache *cache);
+
+/**
+ * @reset_distance_cache : empty @cache in O(1) and make @element the element of the current query
+ *
+ * @cache : the cache to reset
+ * @element : the element of the new query
+ */
+void reset_distance_cache(struct distance_cache *cache, unsigned int element);
+
+/**
+ * @get_distance_cache : look for the exact distance between @a and @b in @cache
+ *
+ * @cache : the cache to look into
+ * @a : the first element
+ * @b : the second element
+ * @distance : where the distance is stored if it is found
+ *
+ * @return 1 if the distance was found, 0 otherwise
+ * @remark : only distances involving the element of the current query are cached
+ */
+int get_distance_cache(struct distance_cache *cache, unsigned int a,
+		       unsigned int b, double *distance);
+
+/**
+ * @check_distance_cache : use the bounds stored in @cache to compare the distance between @a and @b to @radius
+ *
+ * @cache : the cache to look into
+ * @a : the first element
+ * @b : the second element
+ * @radius : the radius to compare the distance to
+ *
+ * @return 1 if the distance is known to be at most @radius, 0 if it is known to be greater, -1 if the cache can not tell
+ */
+int check_distance_cache(struct distance_cache *cache, unsigned int a,
+			 unsigned int b, double radius);
+
+/**
+ * @store_bound_distance_cache : store in @cache the result of the comparison of the distance between @a and @b to @radius
+ *
+ * @cache : the cache to modify
+ * @a : the first element
+ * @b : the second element
+ * @radius : the radius the distance was compared to
+ * @within : 1 if the distance is at most @radius, 0 otherwise
+ *
+ * @remark : does nothing if neither @a nor @b is the element of the current query, or if the cache is half full.
+ */
+void store_bound_distance_cache(struct distance_cache *cache, unsigned int a,
+				unsigned int b, double radius, int within);
+
+/**
+ * @store_distance_cache : store the distance between @a and @b in @cache
+ *
+ * @cache : the cache to modify
+ * @a : the first element
+ * @b : the second element
+ * @distance : the distance between @a and @b
+ *
+ * @remark : does nothing if neither @a nor @b is the element of the current query, or if the cache is half full.
+ */
+void store_distance_cache(struct distance_cache *cache, unsigned int a,
+			  unsigned int b, double distance);
+#endif
@@ -0,0 +1,148 @@
+/**
+This module contains a cache of the directed components of the Hausdorff distance between trajectories and their centers, updated incrementally when the trajectories grow
+**/
+#include "utils.h"
+#include "point.h"
+#include "data_trajectories.h"
+#include "hausdorff_cache.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+void initialise_hausdorff_cache(struct hausdorff_cache *cache,
+				Trajectory * trajectories,
+				unsigned int nb_elements, unsigned int nb_ways)
+{
+	cache->pairs = calloc_wrapper(nb_elements, sizeof(*cache->pairs));
+	cache->nb_elements = nb_elements;
+	cache->nb_ways = nb_ways;
+	cache->trajectories = trajectories;
+	cache->clock = 0;
+	cache->nb_values = 0;
+}
+
+void free_hausdorff_cache(struct hausdorff_cache *cache)
+{
+	unsigned int i, j;
+	for (i = 0; i < cache->nb_elements; i++) {
+		if (NULL == cache->pairs[i])
+			continue;
+		for (j = 0; j < cache->nb_ways; j++) {
+			free(cache->pairs[i][j].forward);
+			free(cache->pairs[i][j].backward);
+		}
+		free(cache->pairs[i]);
+	}
+	free(cache->pairs);
+	cache->pairs = NULL;
+	cache->nb_elements = 0;
+	cache->nb_values = 0;
+}
+
+/**
+ * @get_pair_hausdorff_cache : gives the pair (@element, @center), replacing the least recently used pair of @element if needed
+ *
+ * @return the pair, NULL if there is not enough memory left to store it
+ */
+static struct hausdorff_pair *get_pair_hausdorff_cache(struct hausdorff_cache
+						       *cache,
+						       unsigned int element,
+						       unsigned int center)
+{
+	unsigned int i, capacity;
+	struct hausdorff_pair *ways, *pair;
+	if (NULL == cache->pairs[element]) {
+		cache->pairs[element] =
+		    malloc_wrapper(sizeof(**cache->pairs) * cache->nb_ways);
+		for (i = 0; i < cache->nb_ways; i++) {
+			cache->pairs[element][i].center = (unsigned int)-1;
+			cache->pairs[element][i].last_use = 0;
+			cache->pairs[element][i].capacity = 0;
+			cache->pairs[element][i].forward = NULL;
+			cache->pairs[element][i].backward = NULL;
+		}
+	}
+	pair = ways = cache->pairs[element];
+	for (i = 0; i < cache->nb_ways; i++) {
+		if (ways[i].center == center) {
+			pair = ways + i;
+			pair->last_use = ++cache->clock;
+			return pair;
+		}
+		if (ways[i].last_use < pair->last_use)
+			pair = ways + i;
+	}
+	capacity = MAX(cache->trajectories[element].max_length,
+		       cache->trajectories[center].max_length);
+	if (pair->capacity < capacity) {
+		if (cache->nb_values + 2UL * (capacity - pair->capacity) >
+		    HAUSDORFF_CACHE_MAX_VALUES)
+			return NULL;
+		cache->nb_values += 2UL * (capacity - pair->capacity);
+		free(pair->forward);
+		free(pair->backward);
+		pair->forward = malloc_wrapper(sizeof(double) * capacity);
+		pair->backward = malloc_wrapper(sizeof(double) * capacity);
+		pair->capacity = capacity;
+	}
+	pair->center = center;
+	pair->element_length = 0;
+	pair->center_length = 0;
+	pair->last_use = ++cache->clock;
+	return pair;
+}
+
+/**
+ * @extend_pair : take into account the points of @element and @center added since the last update of @pair
+ *
+ * Each new point of @center is compared to the old points of @element, then each new point of @element to all points of @center, so every pair of points is compared exactly once.
+ */
+static void extend_pair(struct hausdorff_pair *pair, Trajectory * element,
+			Trajectory * center)
+{
+	unsigned int i, j;
+	double tmp;
+	for (j = pair->center_length; j < center->current; j++) {
+		pair->backward[j] = HUGE_VAL;
+		for (i = 0; i < pair->element_length; i++) {
+			tmp = trajectories_point_distance(element, i, center,
+							  j);
+			pair->forward[i] = MIN(tmp, pair->forward[i]);
+			pair->backward[j] = MIN(tmp, pair->backward[j]);
+		}
+	}
+	for (i = pair->element_length; i < element->current; i++) {
+		pair->forward[i] = HUGE_VAL;
+		for (j = 0; j < center->current; j++) {
+			tmp = trajectories_point_distance(element, i, center,
+							  j);
+			pair->forward[i] = MIN(tmp, pair->forward[i]);
+			pair->backward[j] = MIN(tmp, pair->backward[j]);
+		}
+	}
+	pair->element_length = element->current;
+	pair->center_length = center->current;
+}
+
+int hausdorff_cache_distance(struct hausdorff_cache *cache,
+			     unsigned int element, unsigned int center,
+			     double *distance)
+{
+	unsigned int i;
+	double max = 0;
+	struct hausdorff_pair *pair;
+	Trajectory *a = cache->trajectories + element,
+	    *b = cache->trajectories + center;
+	if (0 == a->current || 0 == b->current)
+		return 0;
+	pair = get_pair_hausdorff_cache(cache, element, center);
+	if (NULL == pair)
+		return 0;
+	extend_pair(pair, a, b);
+	for (i = 0; i < pair->element_length; i++)
+		max = MAX(max, pair->forward[i]);
+	for (i = 0; i < pair->center_length; i++)
+		max = MAX(max, pair->backward[i]);
+	*distance = max;
+	return 1;
+}
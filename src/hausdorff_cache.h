@@ -0,0 +1,89 @@
+/**
+This module contains a cache of the directed components of the Hausdorff distance between trajectories and their centers, updated incrementally when the trajectories grow
+**/
+#ifndef __HEADER_HAUSDORFF_CACHE
+#define __HEADER_HAUSDORFF_CACHE
+
+#include "data_trajectories.h"
+
+/**
+ * Maximum number of distances stored by a cache, about 256MB
+ */
+#define HAUSDORFF_CACHE_MAX_VALUES (1UL << 25)
+
+/**
+ * @struct hausdorff_pair : directed components of the distance between an element and a center
+ *
+ * @center : the center, (unsigned int)-1 if the pair is empty
+ * @last_use : date of the last use of the pair, the least recently used pair of an element is replaced first
+ * @element_length : number of points of the element taken into account
+ * @center_length : number of points of the center taken into account
+ * @capacity : number of values @forward and @backward can hold
+ * @forward : distance from each point of the element to the closest point of the center
+ * @backward : distance from each point of the center to the closest point of the element
+ */
+struct hausdorff_pair {
+	unsigned int center;
+	unsigned int last_use;
+	unsigned int element_length;
+	unsigned int center_length;
+	unsigned int capacity;
+	double *forward;
+	double *backward;
+};
+
+/**
+ * @struct hausdorff_cache : @nb_ways pairs for each element
+ *
+ * @pairs : the pairs of each element, allocated at the first use of the element
+ * @nb_elements : number of elements
+ * @nb_ways : number of centers remembered for each element
+ * @trajectories : the trajectories of the elements
+ * @clock : incremented at each use of a pair
+ * @nb_values : number of values allocated for all pairs
+ */
+struct hausdorff_cache {
+	struct hausdorff_pair **pairs;
+	unsigned int nb_elements;
+	unsigned int nb_ways;
+	Trajectory *trajectories;
+	unsigned int clock;
+	unsigned long nb_values;
+};
+
+/**
+ * @initialise_hausdorff_cache : initialise @cache
+ *
+ * @cache : the cache to initialise
+ * @trajectories : the trajectories of the elements
+ * @nb_elements : the number of elements
+ * @nb_ways : the number of centers remembered for each element, usually the number of levels since an element has a center on each of them
+ *
+ * @remark : @cache must be freed with @free_hausdorff_cache to avoid memory leaks
+ */
+void initialise_hausdorff_cache(struct hausdorff_cache *cache,
+				Trajectory * trajectories,
+				unsigned int nb_elements, unsigned int nb_ways);
+
+/**
+ * @free_hausdorff_cache : free @cache
+ *
+ * @cache : the cache to free
+ */
+void free_hausdorff_cache(struct hausdorff_cache *cache);
+
+/**
+ * @hausdorff_cache_distance : computes the distance between @element and @center, only considering the points added since the last call for this pair
+ *
+ * @cache : the cache to use
+ * @element : the element
+ * @center : the center of the element
+ * @distance : where the distance is stored
+ *
+ * @return 1 if the distance was computed, 0 if the pair can not be cached and the distance has to be computed another way
+ * @remark : trajectories only grow, so a pair never has to be invalidated. A pair whose element changes of center is simply not used anymore and is eventually replaced.
+ */
+int hausdorff_cache_distance(struct hausdorff_cache *cache,
+			     unsigned int element, unsigned int center,
+			     double *distance);
+#endif
@@ -0,0 +1,95 @@
+/**
+This file contains a program converting a text data file into a binary dataset, which k-center loads without parsing, and a legacy query file into a query file with a header.
+ **/
+
+#include "utils.h"
+#include "point.h"
+#include "data_sliding.h"
+#include "data_trajectories.h"
+#include "binary_dataset.h"
+#include "query.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static void usage(char *name)
+{
+	fprintf(stderr,
+		"Points (-m, -o or -s data file): %s -m [-i nb_threads] text_file binary_file\n",
+		name);
+	fprintf(stderr,
+		"Trajectories (-p data file): %s -p [-i nb_threads] text_file binary_file\n",
+		name);
+	fprintf(stderr,
+		"Legacy query file of -m, -o or -p: %s -q [-z] -m|-o|-p legacy_file query_file\n",
+		name);
+	fprintf(stderr, "\t-z : compress the records of the query file\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, trajectories = -1, queries = 0;
+	Query_encoding encoding = QUERY_ENCODING_RAW;
+	unsigned int nb_threads = 1, nb_elements;
+	void *points;
+	Trajectory *array;
+	Error_enum tmp;
+	while ((opt = getopt(argc, argv, "hmospqzi:")) != -1) {
+		switch (opt) {
+		case 'm':
+		case 'o':
+		case 's':
+			trajectories = 0;
+			break;
+		case 'p':
+			trajectories = 1;
+			break;
+		case 'q':
+			queries = 1;
+			break;
+		case 'z':
+			encoding = QUERY_ENCODING_STREAMVBYTE;
+			break;
+		case 'i':
+			if (strtoui_wrapper(optarg, &nb_threads)
+			    || 0 == nb_threads) {
+				fprintf(stderr,
+					"Positive number of thread required for -i option\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			return EXIT_SUCCESS;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (-1 == trajectories || argc - optind != 2) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (queries)
+		/* the parity of the occurrences of an index gives its type, except for trajectories */
+		tmp = convert_legacy_queries(argv[optind], argv[optind + 1],
+					     !trajectories, encoding);
+	else if (trajectories) {
+		if (trajectories_import_points(&array, &nb_elements,
+					       argv[optind], nb_threads))
+			return EXIT_FAILURE;
+		tmp = dataset_write_trajectories(argv[optind + 1], array,
+						 nb_elements);
+		trajectories_delete_points(array);
+	} else {
+		/* the timestamps are kept, so the dataset serves -m, -o and -s */
+		if (sliding_import_points(&points, &nb_elements, argv[optind],
+					  0, nb_threads))
+			return EXIT_FAILURE;
+		tmp = dataset_write_points(argv[optind + 1], points,
+					   nb_elements);
+		free(points);
+	}
+	return tmp ? EXIT_FAILURE : EXIT_SUCCESS;
+}
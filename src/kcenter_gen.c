@@ -0,0 +1,781 @@
+/**
+This file contains a program generating synthetic workloads, a data file and its query file in the formats read by k-center, so that the algorithms can be measured on reproducible load shapes. The same seed always gives the same files.
+ **/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "utils.h"
+#include "point.h"
+#include "query.h"
+#include "data_fully_adv.h"
+#include "algo_fully_adv.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**
+ * Default standard deviation, in degrees, of the points around the center of their cloud
+ */
+#define DEFAULT_SPREAD 0.5
+
+/**
+ * Standard deviation, in degrees, of the steps of a trajectory
+ */
+#define TRAJECTORY_STEP 0.01
+
+/**
+ * Number of elements drawn following the Zipf law before falling back on a uniform choice among the present elements
+ */
+#define ZIPF_TRIES 64
+
+/**
+ * Size of the buffer of the data file
+ */
+#define DATA_BUFFER_SIZE (1 << 20)
+
+typedef enum {
+	MIXED_WORKLOAD, SLIDING_WORKLOAD, ADVERSARIAL_WORKLOAD,
+	TRAJECTORIES_WORKLOAD, LAST_WORKLOAD
+} Workload_type;
+
+typedef enum {
+	RANDOM_GROWTH, ROUND_ROBIN_GROWTH, SEQUENTIAL_GROWTH, LAST_GROWTH
+} Growth_type;
+
+/**
+ * @struct gen_args : the arguments of the program
+ */
+struct gen_args {
+	Workload_type workload;	/* the workload asked */
+	uint64_t seed;		/* seed of the generator */
+	Query_encoding encoding;	/* encoding of the query file */
+	unsigned int nb_clouds;	/* number of clouds of points, 0 for uniform points */
+	double spread;		/* standard deviation of the points of a cloud */
+	unsigned int insertions;	/* percentage of insertions of the mix */
+	unsigned int updates;	/* percentage of updates of the mix */
+	double zipf;		/* exponent of the Zipf law of the deletions */
+	unsigned int load;	/* insertions before the mix, nb_points / 2 if not given */
+	int has_load;		/* set if load was given */
+	Growth_type growth;	/* order in which the trajectories grow */
+	Metric_type metric;	/* distance of the simulation of -a */
+	unsigned int k;		/* parameters of the simulation of -a */
+	double eps;
+	double d_min;
+	double d_max;
+	unsigned int nb_points;	/* number of points, of trajectories for -p */
+	unsigned int nb_queries;	/* number of queries, window length for -s, points for -p */
+	char *data_path;	/* path of the data file */
+	char *query_path;	/* path of the query file */
+};
+
+/**
+ * @struct generator : the points written in the data file
+ *
+ * @clouds : longitude and latitude of the center of each cloud
+ * @file : the data file
+ */
+struct generator {
+	double *clouds;
+	FILE *file;
+};
+
+static uint64_t random_state;
+
+/**
+ * @next_random : next value of the splitmix64 generator
+ */
+static uint64_t next_random(void)
+{
+	uint64_t z = (random_state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * @uniform_random : a double uniformly drawn in [0, 1)
+ */
+static double uniform_random(void)
+{
+	return (double)(next_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @bounded_random : an integer uniformly drawn in [0, @bound)
+ */
+static unsigned int bounded_random(unsigned int bound)
+{
+	return (unsigned int)(uniform_random() * bound);
+}
+
+/**
+ * @gaussian_random : a double drawn following the standard normal law, by the Box-Muller transform
+ */
+static double gaussian_random(void)
+{
+	double u = 1 - uniform_random();
+	return sqrt(-2 * log(u)) * cos(2 * M_PI * uniform_random());
+}
+
+/**
+ * @shuffle : shuffle the @nb elements of @array with the generator of the program, rand being kept for the simulation of -a
+ */
+static void shuffle(unsigned int *array, unsigned int nb)
+{
+	unsigned int i, j, tmp;
+	for (i = nb; i > 1; i--) {
+		j = bounded_random(i);
+		tmp = array[i - 1];
+		array[i - 1] = array[j];
+		array[j] = tmp;
+	}
+}
+
+/**
+ * @uniform_point : a point uniformly drawn on the sphere
+ */
+static void uniform_point(double *longitude, double *latitude)
+{
+	*longitude = 360 * uniform_random() - 180;
+	*latitude = asin(2 * uniform_random() - 1) * 180 / M_PI;
+}
+
+/**
+ * @clamp_point : bring a point back to valid coordinates
+ */
+static void clamp_point(double *longitude, double *latitude)
+{
+	*latitude = MAX(-90, MIN(90, *latitude));
+	*longitude = fmod(*longitude + 180, 360);
+	if (*longitude < 0)
+		*longitude += 360;
+	*longitude -= 180;
+}
+
+/**
+ * @random_point : a point drawn uniformly, or around the center of a random cloud
+ */
+static void random_point(struct gen_args *args, struct generator *gen,
+			 double *longitude, double *latitude)
+{
+	unsigned int i;
+	if (0 == args->nb_clouds) {
+		uniform_point(longitude, latitude);
+		return;
+	}
+	i = bounded_random(args->nb_clouds);
+	*longitude = gen->clouds[2 * i] + args->spread * gaussian_random();
+	*latitude = gen->clouds[2 * i + 1] + args->spread * gaussian_random();
+	clamp_point(longitude, latitude);
+}
+
+/**
+ * @open_generator : draw the centers of the clouds and create the data file
+ */
+static void open_generator(struct gen_args *args, struct generator *gen)
+{
+	unsigned int i;
+	gen->clouds = NULL;
+	if (args->nb_clouds) {
+		gen->clouds = malloc_wrapper(sizeof(*gen->clouds) * 2 *
+					     args->nb_clouds);
+		for (i = 0; i < args->nb_clouds; i++)
+			uniform_point(gen->clouds + 2 * i,
+				      gen->clouds + 2 * i + 1);
+	}
+	gen->file = fopen_wrapper(args->data_path, "w");
+	setvbuf(gen->file, NULL, _IOFBF, DATA_BUFFER_SIZE);
+}
+
+/**
+ * @close_generator : close the data file
+ *
+ * @return NO_ERROR if it was written, IO_ERROR otherwise
+ */
+static Error_enum close_generator(struct gen_args *args, struct generator *gen)
+{
+	int error = ferror(gen->file);
+	free(gen->clouds);
+	if (fclose(gen->file) || error) {
+		fprintf(stderr, "An error occured while writing %s\n",
+			args->data_path);
+		return IO_ERROR;
+	}
+	return NO_ERROR;
+}
+
+/**
+ * @write_points : write @nb random points in the data file, the timestamp of a point being the one of the previous point plus a random gap of 0 to @max_gap
+ */
+static void write_points(struct gen_args *args, struct generator *gen,
+			 unsigned int nb, unsigned int max_gap)
+{
+	double longitude, latitude;
+	unsigned int i, timestamp = 0;
+	for (i = 0; i < nb; i++) {
+		random_point(args, gen, &longitude, &latitude);
+		timestamp += bounded_random(max_gap + 1);
+		fprintf(gen->file, "%u\t%f %f\n", timestamp, longitude,
+			latitude);
+	}
+}
+
+/**
+ * @struct presence : the elements of a data file split between the present ones, at the beginning of @elements, and the absent ones
+ */
+struct presence {
+	unsigned int *elements;
+	unsigned int *positions;	/* position of each element in @elements */
+	unsigned int nb_present;
+	unsigned int nb;
+};
+
+static void swap_presence(struct presence *presence, unsigned int i,
+			  unsigned int j)
+{
+	unsigned int a = presence->elements[i], b = presence->elements[j];
+	presence->elements[i] = b;
+	presence->elements[j] = a;
+	presence->positions[b] = i;
+	presence->positions[a] = j;
+}
+
+/**
+ * @insert_absent : make a random absent element present
+ *
+ * @return the element
+ */
+static unsigned int insert_absent(struct presence *presence)
+{
+	unsigned int i = presence->nb_present +
+	    bounded_random(presence->nb - presence->nb_present);
+	swap_presence(presence, i, presence->nb_present);
+	return presence->elements[presence->nb_present++];
+}
+
+/**
+ * @remove_present : make the present element @element absent
+ */
+static void remove_present(struct presence *presence, unsigned int element)
+{
+	swap_presence(presence, presence->positions[element],
+		      --(presence->nb_present));
+}
+
+/**
+ * @struct zipf : Zipf law over the elements, the most popular ones being drawn at random
+ *
+ * @popular : the elements by decreasing popularity
+ * @cumulative : the distribution function of the ranks
+ */
+struct zipf {
+	unsigned int *popular;
+	double *cumulative;
+	unsigned int nb;
+};
+
+static void initialise_zipf(struct zipf *zipf, unsigned int nb,
+			    double exponent)
+{
+	unsigned int i;
+	double sum = 0;
+	zipf->nb = nb;
+	zipf->popular = malloc_wrapper(sizeof(*zipf->popular) * nb);
+	zipf->cumulative = malloc_wrapper(sizeof(*zipf->cumulative) * nb);
+	for (i = 0; i < nb; i++) {
+		zipf->popular[i] = i;
+		sum += pow(i + 1, -exponent);
+		zipf->cumulative[i] = sum;
+	}
+	for (i = 0; i < nb; i++)
+		zipf->cumulative[i] /= sum;
+	shuffle(zipf->popular, nb);
+}
+
+static void free_zipf(struct zipf *zipf)
+{
+	free(zipf->popular);
+	free(zipf->cumulative);
+}
+
+/**
+ * @draw_zipf : an element drawn following the Zipf law
+ */
+static unsigned int draw_zipf(struct zipf *zipf)
+{
+	double u = uniform_random();
+	unsigned int low = 0, high = zipf->nb - 1, middle;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (zipf->cumulative[middle] <= u)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return zipf->popular[low];
+}
+
+/**
+ * @draw_deletion : a present element, following the Zipf law of @zipf if any
+ */
+static unsigned int draw_deletion(struct presence *presence, struct zipf *zipf)
+{
+	unsigned int i, element;
+	if (NULL != zipf)
+		for (i = 0; i < ZIPF_TRIES; i++) {
+			element = draw_zipf(zipf);
+			if (presence->positions[element] < presence->nb_present)
+				return element;
+		}
+	return presence->elements[bounded_random(presence->nb_present)];
+}
+
+/**
+ * @generate_mixed : @nb_points points and, after the insertion of @load of them, @nb_queries insertions, deletions and updates, an update being the deletion and the insertion of the same element
+ */
+static void generate_mixed(struct gen_args *args, struct generator *gen,
+			   struct query_writer *writer)
+{
+	struct presence presence;
+	struct zipf zipf, *skew = NULL;
+	unsigned int i, element, u;
+	write_points(args, gen, args->nb_points, 1);
+	presence.nb = args->nb_points;
+	presence.nb_present = 0;
+	presence.elements = malloc_wrapper(sizeof(*presence.elements) *
+					   presence.nb);
+	presence.positions = malloc_wrapper(sizeof(*presence.positions) *
+					    presence.nb);
+	for (i = 0; i < presence.nb; i++)
+		presence.elements[i] = presence.positions[i] = i;
+	if (0 < args->zipf) {
+		initialise_zipf(&zipf, presence.nb, args->zipf);
+		skew = &zipf;
+	}
+	for (i = 0; i < args->load; i++)
+		write_query(writer, ADD, insert_absent(&presence));
+	for (i = 0; 0 < presence.nb && i < args->nb_queries; i++) {
+		u = bounded_random(100);
+		if (presence.nb_present < presence.nb
+		    && (u < args->insertions || 0 == presence.nb_present)) {
+			write_query(writer, ADD, insert_absent(&presence));
+			continue;
+		}
+		element = draw_deletion(&presence, skew);
+		write_query(writer, REMOVE, element);
+		if (u < args->insertions + args->updates)
+			write_query(writer, ADD, element);
+		else
+			remove_present(&presence, element);
+	}
+	if (NULL != skew)
+		free_zipf(skew);
+	free(presence.elements);
+	free(presence.positions);
+}
+
+/**
+ * @generate_sliding : @nb_points points and the queries of a sliding window of @nb_queries units of time, as written by sliding_query
+ */
+static void generate_sliding(struct gen_args *args, struct generator *gen,
+			     struct query_writer *writer)
+{
+	double longitude, latitude;
+	unsigned int *timestamps = malloc_wrapper(sizeof(*timestamps) *
+						  args->nb_points);
+	unsigned int current, oldest = 0, timestamp = 0;
+	for (current = 0; current < args->nb_points; current++) {
+		random_point(args, gen, &longitude, &latitude);
+		timestamp += bounded_random(3);
+		timestamps[current] = timestamp;
+		fprintf(gen->file, "%u\t%f %f\n", timestamp, longitude,
+			latitude);
+		while (oldest < current
+		       && timestamps[oldest] + args->nb_queries < timestamp)
+			write_query(writer, REMOVE, oldest++);
+		write_query(writer, ADD, current);
+	}
+	free(timestamps);
+}
+
+/**
+ * @worst_center : sum in @costs the number of reinsertions caused by the deletion of each center of @levels, over all of them, @costs being left to 0
+ *
+ * @return a center whose deletion causes the most reinsertions
+ */
+static unsigned int worst_center(Fully_adv_cluster levels[],
+				 unsigned int nb_instances,
+				 unsigned long *costs)
+{
+	unsigned int i, j, worst = levels[0].centers[0];
+	unsigned long after;
+	for (i = 0; i < nb_instances; i++) {
+		/* deleting the center of cluster j reinserts the elements of the clusters after it */
+		after = levels[i].clusters.sets[levels[i].k].card;
+		for (j = levels[i].nb; j-- > 0;) {
+			after += levels[i].clusters.sets[j].card;
+			costs[levels[i].centers[j]] += after;
+		}
+	}
+	for (i = 0; i < nb_instances; i++)
+		for (j = 0; j < levels[i].nb; j++)
+			if (costs[levels[i].centers[j]] > costs[worst]
+			    || (costs[levels[i].centers[j]] == costs[worst]
+				&& levels[i].centers[j] < worst))
+				worst = levels[i].centers[j];
+	for (i = 0; i < nb_instances; i++)
+		for (j = 0; j < levels[i].nb; j++)
+			costs[levels[i].centers[j]] = 0;
+	return worst;
+}
+
+/**
+ * @generate_adversarial : @nb_points points inserted in a random order, then @nb_queries times the deletion and reinsertion of the center whose deletion reinserts the most elements, found by running the fully adversary algorithm with the same parameters and seed as k-center -m -r seed
+ *
+ * @return NO_ERROR if no error happens and something else otherwise
+ */
+static Error_enum generate_adversarial(struct gen_args *args,
+				       struct generator *gen,
+				       struct query_writer *writer)
+{
+	Fully_adv_cluster *levels;
+	unsigned int *order, *helper_array, nb_instances, nb, i, j, worst;
+	unsigned long *costs;
+	void *points;
+	Unit_vector *units;
+	Error_enum tmp;
+	write_points(args, gen, args->nb_points, 1);
+	tmp = close_generator(args, gen);
+	if (tmp)
+		return tmp;
+	/* the points are read back so that the simulation sees the rounded coordinates of k-center */
+	set_metric(args->metric);
+	if (fully_adv_import_points(&points, &nb, args->data_path, 1))
+		return FILE_FORMAT_ERROR;
+	units = unit_vector_array(points, nb);
+	fully_adv_initialise_level_array(&levels, args->k, args->eps,
+					 args->d_min, args->d_max,
+					 &nb_instances, points, units, nb, nb,
+					 &helper_array,
+					 args->k >= CENTER_GRID_MIN_K, NULL);
+	srand((unsigned int)args->seed);
+	order = malloc_wrapper(sizeof(*order) * nb);
+	for (i = 0; i < nb; i++)
+		order[i] = i;
+	shuffle(order, nb);
+	for (i = 0; i < nb; i++) {
+		write_query(writer, ADD, order[i]);
+		for (j = 0; j < nb_instances; j++)
+			fully_adv_k_center_add(levels + j, order[i]);
+	}
+	costs = calloc_wrapper(MAX(nb, 1), sizeof(*costs));
+	for (i = 0; 0 < nb && i < args->nb_queries; i++) {
+		worst = worst_center(levels, nb_instances, costs);
+		write_query(writer, REMOVE, worst);
+		for (j = 0; j < nb_instances; j++)
+			fully_adv_k_center_delete(levels + j, worst,
+						  helper_array);
+		write_query(writer, ADD, worst);
+		for (j = 0; j < nb_instances; j++)
+			fully_adv_k_center_add(levels + j, worst);
+	}
+	free(costs);
+	free(order);
+	fully_adv_delete_level_array(levels, nb_instances, helper_array);
+	free(points);
+	free(units);
+	return NO_ERROR;
+}
+
+/**
+ * @generate_trajectories : @nb_points points split at random among @nb_points trajectories, random walks starting from random points, and the insertions growing them in the order asked
+ */
+static void generate_trajectories(struct gen_args *args, struct generator *gen,
+				  struct query_writer *writer)
+{
+	unsigned int nb = args->nb_points, total = args->nb_queries;
+	unsigned int *lengths = malloc_wrapper(sizeof(*lengths) * nb);
+	unsigned int *order, i, j, nb_active;
+	double longitude, latitude;
+	for (i = 0; i < nb; i++)
+		lengths[i] = 1;
+	for (i = nb; i < total; i++)
+		lengths[bounded_random(nb)]++;
+	fprintf(gen->file, "%u %u\n", nb, total);
+	for (i = 0; i < nb; i++) {
+		random_point(args, gen, &longitude, &latitude);
+		fprintf(gen->file, "%u\t%u", i, lengths[i]);
+		for (j = 0; j < lengths[i]; j++) {
+			fprintf(gen->file, "\t%f,%f", longitude, latitude);
+			longitude += TRAJECTORY_STEP * gaussian_random();
+			latitude += TRAJECTORY_STEP * gaussian_random();
+			clamp_point(&longitude, &latitude);
+		}
+		fprintf(gen->file, "\n");
+	}
+	order = malloc_wrapper(sizeof(*order) * MAX(total, nb));
+	switch (args->growth) {
+	case SEQUENTIAL_GROWTH:
+		for (i = 0; i < nb; i++)
+			for (j = 0; j < lengths[i]; j++)
+				write_query(writer, ADD, i);
+		break;
+	case ROUND_ROBIN_GROWTH:
+		/* the trajectories still growing, in order */
+		for (i = 0; i < nb; i++)
+			order[i] = i;
+		nb_active = nb;
+		while (nb_active) {
+			for (i = j = 0; i < nb_active; i++) {
+				write_query(writer, ADD, order[i]);
+				if (--lengths[order[i]])
+					order[j++] = order[i];
+			}
+			nb_active = j;
+		}
+		break;
+	default:
+		for (i = j = 0; i < nb; i++)
+			while (lengths[i]--)
+				order[j++] = i;
+		shuffle(order, total);
+		for (i = 0; i < total; i++)
+			write_query(writer, ADD, order[i]);
+	}
+	free(order);
+	free(lengths);
+}
+
+static void usage(char *name)
+{
+	fprintf(stderr,
+		"Mixed insertions, deletions and updates: %s -m [-r seed -z -c nb_clouds -w spread -i insertions -u updates -d exponent -l load] nb_points nb_queries data_file query_file\n",
+		name);
+	fprintf(stderr,
+		"Sliding window: %s -s [-r seed -z -c nb_clouds -w spread] nb_points window_length data_file query_file\n",
+		name);
+	fprintf(stderr,
+		"Deletions of centers: %s -a [-r seed -z -c nb_clouds -w spread -e] k eps d_min d_max nb_points nb_deletions data_file query_file\n",
+		name);
+	fprintf(stderr,
+		"Trajectories: %s -p [-r seed -z -c nb_clouds -g random|round_robin|sequential] nb_trajectories nb_points data_file query_file\n",
+		name);
+	fprintf(stderr,
+		"-r seed of the generator, 1 by default, to give to k-center -r to replay -a\n");
+	fprintf(stderr, "-z compresses the query file\n");
+	fprintf(stderr,
+		"-c draws the points around nb_clouds random centers, with a standard deviation of spread degrees (-w, %g by default), instead of uniformly\n",
+		DEFAULT_SPREAD);
+	fprintf(stderr,
+		"-i and -u give the percentages of insertions and updates of the mix, 40 and 20 by default, the other queries being deletions\n");
+	fprintf(stderr,
+		"-d draws the deleted elements following a Zipf law of this exponent, 0 (uniform) by default\n");
+	fprintf(stderr,
+		"-l number of insertions before the mix, nb_points / 2 by default\n");
+	fprintf(stderr,
+		"-e uses great-circle distances, as k-center -e\n");
+	fprintf(stderr,
+		"-g order in which the trajectories grow, random by default\n");
+}
+
+/**
+ * @parse_percentage : parse @arg as a percentage into @value
+ */
+static Error_enum parse_percentage(char *arg, unsigned int *value)
+{
+	if (strtoui_wrapper(arg, value) || 100 < *value) {
+		fprintf(stderr, "Percentage required instead of %s\n", arg);
+		return FILE_FORMAT_ERROR;
+	}
+	return NO_ERROR;
+}
+
+/**
+ * @parse_options : parse the options of the command line into @args
+ *
+ * @return NO_ERROR if they are valid, FILE_FORMAT_ERROR otherwise
+ */
+static Error_enum parse_options(int argc, char *argv[], struct gen_args *args)
+{
+	unsigned int seed, nb_args;
+	int opt;
+	args->workload = LAST_WORKLOAD;
+	args->seed = 1;
+	args->encoding = QUERY_ENCODING_RAW;
+	args->nb_clouds = 0;
+	args->spread = DEFAULT_SPREAD;
+	args->insertions = 40;
+	args->updates = 20;
+	args->zipf = 0;
+	args->has_load = 0;
+	args->growth = RANDOM_GROWTH;
+	args->metric = EUCLIDEAN_METRIC;
+	while ((opt = getopt(argc, argv, "hmsapr:zc:w:i:u:d:l:eg:")) != -1) {
+		switch (opt) {
+		case 'm':
+			args->workload = MIXED_WORKLOAD;
+			break;
+		case 's':
+			args->workload = SLIDING_WORKLOAD;
+			break;
+		case 'a':
+			args->workload = ADVERSARIAL_WORKLOAD;
+			break;
+		case 'p':
+			args->workload = TRAJECTORIES_WORKLOAD;
+			break;
+		case 'r':
+			if (strtoui_wrapper(optarg, &seed)) {
+				fprintf(stderr, "Unsigned seed required\n");
+				return FILE_FORMAT_ERROR;
+			}
+			args->seed = seed;
+			break;
+		case 'z':
+			args->encoding = QUERY_ENCODING_STREAMVBYTE;
+			break;
+		case 'c':
+			if (strtoui_wrapper(optarg, &args->nb_clouds)) {
+				fprintf(stderr,
+					"Number of clouds required for -c\n");
+				return FILE_FORMAT_ERROR;
+			}
+			break;
+		case 'w':
+			if (strtod_wrapper(optarg, &args->spread)
+			    || 0 > args->spread) {
+				fprintf(stderr,
+					"Positive spread required for -w\n");
+				return FILE_FORMAT_ERROR;
+			}
+			break;
+		case 'i':
+			if (parse_percentage(optarg, &args->insertions))
+				return FILE_FORMAT_ERROR;
+			break;
+		case 'u':
+			if (parse_percentage(optarg, &args->updates))
+				return FILE_FORMAT_ERROR;
+			break;
+		case 'd':
+			if (strtod_wrapper(optarg, &args->zipf)
+			    || 0 > args->zipf) {
+				fprintf(stderr,
+					"Positive exponent required for -d\n");
+				return FILE_FORMAT_ERROR;
+			}
+			break;
+		case 'l':
+			if (strtoui_wrapper(optarg, &args->load)) {
+				fprintf(stderr,
+					"Number of insertions required for -l\n");
+				return FILE_FORMAT_ERROR;
+			}
+			args->has_load = 1;
+			break;
+		case 'e':
+			args->metric = GREAT_CIRCLE_METRIC;
+			break;
+		case 'g':
+			if (0 == strcmp(optarg, "random"))
+				args->growth = RANDOM_GROWTH;
+			else if (0 == strcmp(optarg, "round_robin"))
+				args->growth = ROUND_ROBIN_GROWTH;
+			else if (0 == strcmp(optarg, "sequential"))
+				args->growth = SEQUENTIAL_GROWTH;
+			else {
+				fprintf(stderr, "Unknown growth %s\n", optarg);
+				return FILE_FORMAT_ERROR;
+			}
+			break;
+		default:
+			return FILE_FORMAT_ERROR;
+		}
+	}
+	nb_args = ADVERSARIAL_WORKLOAD == args->workload ? 8 : 4;
+	if (LAST_WORKLOAD == args->workload
+	    || (unsigned int)(argc - optind) != nb_args)
+		return FILE_FORMAT_ERROR;
+	argv += optind;
+	if (ADVERSARIAL_WORKLOAD == args->workload) {
+		if (strtoui_wrapper(argv[0], &args->k) || 0 == args->k
+		    || strtod_wrapper(argv[1], &args->eps) || 0 >= args->eps
+		    || strtod_wrapper(argv[2], &args->d_min)
+		    || 0 >= args->d_min
+		    || strtod_wrapper(argv[3], &args->d_max)
+		    || args->d_max < args->d_min) {
+			fprintf(stderr,
+				"Positive k, eps, d_min and d_max >= d_min required\n");
+			return FILE_FORMAT_ERROR;
+		}
+		argv += 4;
+	}
+	if (strtoui_wrapper(argv[0], &args->nb_points)
+	    || strtoui_wrapper(argv[1], &args->nb_queries)) {
+		fprintf(stderr, "Unsigned sizes required\n");
+		return FILE_FORMAT_ERROR;
+	}
+	if (args->nb_points > QUERY_INDEX_MASK
+	    || (TRAJECTORIES_WORKLOAD == args->workload
+		&& (0 == args->nb_points
+		    || args->nb_queries < args->nb_points))) {
+		fprintf(stderr,
+			"Too many points, or fewer points than trajectories\n");
+		return FILE_FORMAT_ERROR;
+	}
+	if (args->insertions + args->updates > 100) {
+		fprintf(stderr,
+			"The insertions and updates exceed 100 percent\n");
+		return FILE_FORMAT_ERROR;
+	}
+	if (!args->has_load)
+		args->load = args->nb_points / 2;
+	args->load = MIN(args->load, args->nb_points);
+	args->data_path = argv[2];
+	args->query_path = argv[3];
+	return NO_ERROR;
+}
+
+int main(int argc, char *argv[])
+{
+	struct gen_args args;
+	struct generator gen;
+	struct query_writer *writer;
+	Error_enum tmp = NO_ERROR;
+	if (parse_options(argc, argv, &args)) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	random_state = args.seed;
+	writer = malloc_wrapper(sizeof(*writer));
+	open_query_writer(writer, args.query_path, args.encoding);
+	open_generator(&args, &gen);
+	switch (args.workload) {
+	case MIXED_WORKLOAD:
+		generate_mixed(&args, &gen, writer);
+		break;
+	case SLIDING_WORKLOAD:
+		generate_sliding(&args, &gen, writer);
+		break;
+	case ADVERSARIAL_WORKLOAD:
+		/* closes the data file to read it back */
+		tmp = generate_adversarial(&args, &gen, writer);
+		break;
+	default:
+		generate_trajectories(&args, &gen, writer);
+	}
+	if (ADVERSARIAL_WORKLOAD != args.workload)
+		tmp = close_generator(&args, &gen);
+	if (close_query_writer(writer))
+		tmp = IO_ERROR;
+	free(writer);
+	return tmp ? EXIT_FAILURE : EXIT_SUCCESS;
+}
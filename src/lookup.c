@@ -5,52 +5,202 @@
 #include <assert.h>
 #include <string.h>
 
+/**
+ * Number of chunks a lookup slab can index when it is initialised
+ */
+#define LOOKUP_SLAB_MIN_CHUNKS 4
+
+/**
+ * @initialise_lookup_slab : initialise @slab for blocks holding @header_size bytes followed by @nb_intervals intervals, the intervals ending the block
+ */
+static void initialise_lookup_slab(struct lookup_slab *slab, size_t header_size,
+				   unsigned int nb_intervals)
+{
+	/* the blocks stay aligned for the pointers of the nodes */
+	slab->block_size = (header_size + nb_intervals * sizeof(struct interval)
+			    + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+	slab->max_chunks = LOOKUP_SLAB_MIN_CHUNKS;
+	slab->chunks = malloc_wrapper(sizeof(*slab->chunks) * slab->max_chunks);
+	slab->nb_chunks = 0;
+	slab->nb_carved = LOOKUP_SLAB_BLOCKS;
+	slab->free_blocks = NULL;
+}
+
+static void free_lookup_slab(struct lookup_slab *slab)
+{
+	size_t i;
+	for (i = 0; i < slab->nb_chunks; i++)
+		free(slab->chunks[i]);
+	free(slab->chunks);
+	slab->chunks = NULL;
+	slab->nb_chunks = slab->max_chunks = 0;
+	slab->free_blocks = NULL;
+}
+
+/**
+ * @take_lookup_block : gives a block of @slab, reusing the ones given back first
+ */
+static unsigned char *take_lookup_block(struct lookup_slab *slab)
+{
+	unsigned char *block = slab->free_blocks;
+	if (NULL != block) {
+		slab->free_blocks = *(void **)block;
+		return block;
+	}
+	if (LOOKUP_SLAB_BLOCKS == slab->nb_carved) {
+		if (slab->nb_chunks == slab->max_chunks)
+			slab->chunks = realloc_wrapper(slab->chunks,
+						       &(slab->max_chunks),
+						       sizeof(*slab->chunks));
+		slab->chunks[slab->nb_chunks++] =
+		    malloc_wrapper(slab->block_size * LOOKUP_SLAB_BLOCKS);
+		slab->nb_carved = 0;
+	}
+	return slab->chunks[slab->nb_chunks - 1] +
+	    slab->block_size * slab->nb_carved++;
+}
+
+/**
+ * @give_back_lookup_block : put @block back in the free list of @slab
+ */
+static void give_back_lookup_block(struct lookup_slab *slab, void *block)
+{
+	*(void **)block = slab->free_blocks;
+	slab->free_blocks = block;
+}
+
 /**
  * @allocate_lookup_node : allocate a new lookup node for @element
  *
+ * @lookup : the lookup table of the node
+ * @slab : the slab the node is taken from, its lookup list ending its block
  * @element : the element of the new node
- * @k : length of the lookup list of the node
  *
- * @return a new allocated node with all but the element and lookup_list fields initialised to 0
+ * @return a new allocated node with all but the element and lookup_list fields initialised to 0, its lookup list being empty
  * @remark : the node must be freed with @free_lookup_node to avoid memory leak
  */
-static struct lookup_node *allocate_lookup_node(unsigned int element,
-						   unsigned int k)
+static struct lookup_node *allocate_lookup_node(struct lookup_table *lookup,
+						struct lookup_slab *slab,
+						unsigned int element)
 {
-	struct lookup_node *tmp;
-	tmp = calloc_wrapper(1,sizeof(*tmp));
+	unsigned char *block = take_lookup_block(slab);
+	struct lookup_node *tmp = (struct lookup_node *)block;
+	memset(tmp, 0, sizeof(*tmp));
 	tmp->element = element;
-	tmp->lookup_list = calloc_wrapper(k, sizeof(*tmp->lookup_list));
+	tmp->lookup_list.intervals =
+	    (struct interval *)(block + slab->block_size) - lookup->max_inline;
+	tmp->lookup_list.max = lookup->max_inline;
 	return tmp;
 }
 /**
  * @reset_lookup_node : reset @node to its state after being allocated.
  *
  * @node : the node to reset
- * @k : the length of the lookup_list
  */
-static void reset_lookup_node(struct lookup_node * node, unsigned int k)
+static void reset_lookup_node(struct lookup_node * node)
 {
 	unsigned int tmp_elem=node->element;
-	struct interval *tmp_list=node->lookup_list;
-	memset(node->lookup_list, 0, sizeof(*node->lookup_list) * k);
+	struct lookup_list tmp_list=node->lookup_list;
 	memset(node,0,sizeof(*node));
 	node->lookup_list=tmp_list;
+	node->lookup_list.nb=0;
 	node->element=tmp_elem;
 }
 
+/**
+ * @free_lookup_list : free the intervals of @list if they are not in the block of its node
+ */
+static void free_lookup_list(struct lookup_table *lookup,
+			     struct lookup_list *list)
+{
+	if (list->max > lookup->max_inline)
+		free(list->intervals);
+}
+
 /**
  * @free_lookup_node : free @node
  *
+ * @lookup : the lookup table of the node
+ * @slab : the slab @node was taken from
  * @node : the node to free
  *
  * @remark : @node must have been previously allocated using @allocate_lookup_node.
  */
-static void free_lookup_node(struct lookup_node * node)
+static void free_lookup_node(struct lookup_table *lookup,
+			     struct lookup_slab *slab, struct lookup_node * node)
 {
-	free(node->lookup_list);
+	free_lookup_list(lookup, &(node->lookup_list));
 	node->parent = node->next= node->previous= node->first_child=NULL;
-	free(node);
+	give_back_lookup_block(slab, node);
+}
+
+/**
+ * @reserve_lookup_list : let @list hold @nb intervals, at most the number of clusters
+ */
+static void reserve_lookup_list(struct lookup_table *lookup,
+				struct lookup_list *list, unsigned int nb)
+{
+	struct interval *intervals;
+	unsigned int max;
+	if (nb <= list->max)
+		return;
+	max = MIN(lookup->k, MAX(nb, 2 * list->max));
+	intervals = malloc_wrapper(sizeof(*intervals) * max);
+	memcpy(intervals, list->intervals, sizeof(*intervals) * list->nb);
+	free_lookup_list(lookup, list);
+	list->intervals = intervals;
+	list->max = max;
+}
+
+/**
+ * @position_lookup_list : gives the position in @list of the first interval whose cluster is at least @cluster
+ */
+static unsigned int position_lookup_list(struct lookup_list *list,
+					 unsigned int cluster)
+{
+	unsigned int i;
+	for (i = 0; i < list->nb && list->intervals[i].cluster < cluster; i++) ;
+	return i;
+}
+
+/**
+ * @has_cluster_lookup_list : check if the interval of @list at @position is the one of @cluster
+ */
+static unsigned int has_cluster_lookup_list(struct lookup_list *list,
+					    unsigned int position,
+					    unsigned int cluster)
+{
+	return position < list->nb && cluster == list->intervals[position].cluster;
+}
+
+/**
+ * @put_interval : write the interval [@begin, @end) of @cluster in @interval, unless it is [0, 0) which is not stored
+ *
+ * @return the number of intervals written
+ */
+static unsigned int put_interval(struct interval *interval,
+				 unsigned int cluster, unsigned int begin,
+				 unsigned int end)
+{
+	if (0 == begin && 0 == end)
+		return 0;
+	interval->cluster = cluster;
+	interval->begin = begin;
+	interval->end = end;
+	return 1;
+}
+
+/**
+ * @copy_lookup_list : copy @source in @destination
+ */
+static void copy_lookup_list(struct lookup_table *lookup,
+			     struct lookup_list *destination,
+			     struct lookup_list *source)
+{
+	reserve_lookup_list(lookup, destination, source->nb);
+	memcpy(destination->intervals, source->intervals,
+	       sizeof(*source->intervals) * source->nb);
+	destination->nb = source->nb;
 }
 
 int is_leaf_lookup(struct lookup_node * node)
@@ -58,6 +208,24 @@ int is_leaf_lookup(struct lookup_node * node)
 	return NULL == node->first_child;
 }
 
+struct lookup_node *first_leaf_lookup(struct lookup_node * root)
+{
+	while (NULL != root->first_child)
+		root = root->first_child;
+	return root;
+}
+
+struct lookup_node *next_leaf_lookup(struct lookup_node * root,
+				     struct lookup_node * leaf)
+{
+	while (root != leaf && NULL == leaf->next)
+		leaf = leaf->parent;
+	if (root == leaf)
+		return NULL;
+	PREFETCH(leaf->next->next);
+	return first_leaf_lookup(leaf->next);
+}
+
 static void allocate_leftovers_lookup(struct lookup_table * lookup)
 {
 	lookup->leftovers =
@@ -88,13 +256,46 @@ void initialise_lookup(struct lookup_table * lookup, unsigned int k,
 {
 	lookup->lookup_table =
 		calloc_wrapper( k * nb_level, sizeof(*lookup->lookup_table));
-	lookup->tmp = malloc_wrapper(sizeof(*lookup->tmp) * k);
+	lookup->tmp.intervals = malloc_wrapper(sizeof(*lookup->tmp.intervals) * k);
+	lookup->tmp.nb = 0;
+	lookup->tmp.max = k;
 	lookup->k = k;
 	lookup->nb_level = nb_level;
 	lookup->range_elements = range_elements;
 	lookup->elements =
 		calloc_wrapper(lookup->range_elements,sizeof(*lookup->elements));
 	allocate_leftovers_lookup(lookup);
+	lookup->max_stack = nb_level + 2;
+	lookup->stack = malloc_wrapper(sizeof(*lookup->stack) * lookup->max_stack);
+	/* an element is the center of at most one cluster per level */
+	lookup->max_inline = MIN(k, nb_level + 1);
+	initialise_lookup_slab(&(lookup->nodes), sizeof(struct lookup_node),
+			       lookup->max_inline);
+	initialise_lookup_slab(&(lookup->leaves), sizeof(struct lookup_node) +
+			       sizeof(struct lookup_list),
+			       2 * lookup->max_inline);
+}
+
+void resize_lookup(struct lookup_table * lookup, unsigned int range_elements)
+{
+	struct lookup_info *elements;
+	struct leftovers_ptr *leftovers_ptr;
+	unsigned int i;
+	assert(range_elements >= lookup->range_elements);
+	elements = calloc_wrapper(range_elements, sizeof(*elements));
+	memcpy(elements, lookup->elements,
+	       sizeof(*elements) * lookup->range_elements);
+	for (i = 0; i < lookup->range_elements; i++)
+		if (NULL != elements[i].leaf)
+			elements[i].leaf->related_element = elements + i;
+	free(lookup->elements);
+	lookup->elements = elements;
+	leftovers_ptr = calloc_wrapper(range_elements, sizeof(*leftovers_ptr));
+	memcpy(leftovers_ptr, lookup->leftovers_ptr,
+	       sizeof(*leftovers_ptr) * lookup->range_elements);
+	free(lookup->leftovers_ptr);
+	lookup->leftovers_ptr = leftovers_ptr;
+	lookup->range_elements = range_elements;
 }
 
 /**
@@ -105,11 +306,12 @@ void initialise_lookup(struct lookup_table * lookup, unsigned int k,
  */
 static void remove_lookup_ptr(struct lookup_table * lookup, struct lookup_node * node)
 {
-	struct interval *lookup_list = node->lookup_list;
+	struct interval *interval = node->lookup_list.intervals;
 	unsigned int i, j;
-	for (i = 0; i < lookup->k; i++) {
-		for (j = lookup_list[i].begin; j < lookup_list[i].end; j++) {
-			lookup->lookup_table[j * lookup->k + i] = NULL;
+	for (i = 0; i < node->lookup_list.nb; i++, interval++) {
+		for (j = interval->begin; j < interval->end; j++) {
+			lookup->lookup_table[j * lookup->k + interval->cluster] =
+			    NULL;
 		}
 	}
 }
@@ -139,10 +341,14 @@ void create_leaf_element_lookup(struct lookup_table * lookup, unsigned int eleme
 {
 	struct lookup_node *tmp;
 	struct lookup_info *info = lookup->elements + element;
-	tmp = allocate_lookup_node(element, lookup->k);
+	tmp = allocate_lookup_node(lookup, &(lookup->leaves), element);
 	tmp->related_element = info;
 	info->leaf = tmp;
-	info->clusters=calloc_wrapper(lookup->k,sizeof(*info->clusters));
+	/* the clusters of the element are between the leaf and its lookup list */
+	info->clusters = (struct lookup_list *)(tmp + 1);
+	info->clusters->intervals = tmp->lookup_list.intervals - lookup->max_inline;
+	info->clusters->nb = 0;
+	info->clusters->max = lookup->max_inline;
 }
 
 void remove_leaf_element_lookup(struct lookup_table * lookup, unsigned int element)
@@ -150,24 +356,61 @@ void remove_leaf_element_lookup(struct lookup_table * lookup, unsigned int eleme
 	struct lookup_node *tmp;
 	struct lookup_info *info = lookup->elements + element;
 	tmp = info->leaf;
-	free(info->clusters);
-	free_lookup_node(tmp);
+	free_lookup_list(lookup, info->clusters);
+	free_lookup_node(lookup, &(lookup->leaves), tmp);
+	info->clusters = NULL;
+	info->leaf = NULL;
 }
 
-void delete_lookup_tree(struct lookup_table * lookup, struct lookup_node * node)
+/**
+ * @push_lookup_stack : put @node on the stack of @lookup, holding @nb nodes
+ */
+static void push_lookup_stack(struct lookup_table * lookup, size_t *nb,
+			      struct lookup_node * node)
 {
-	struct lookup_node *tmp;
-	if (node->marked)
-		remove_lookup_ptr(lookup, node);
-	if(node->first_child){
-		while(node->first_child){
-			tmp=node->first_child;
-			node->first_child=tmp->next;
-			delete_lookup_tree(lookup, tmp);
+	if (*nb == lookup->max_stack)
+		lookup->stack = realloc_wrapper(lookup->stack, &(lookup->max_stack),
+						sizeof(*lookup->stack));
+	lookup->stack[(*nb)++] = node;
+}
+
+/**
+ * @next_child_lookup_stack : detach and give the next child of the deepest node of the stack of @lookup having children left, the nodes left without children being freed
+ *
+ * @lookup : the lookup table whose stack is used
+ * @nb : the number of nodes in the stack, updated
+ *
+ * @return the child, NULL once the stack is empty
+ */
+static struct lookup_node *next_child_lookup_stack(struct lookup_table * lookup,
+						   size_t *nb)
+{
+	struct lookup_node *node, *child;
+	while (0 < *nb) {
+		node = lookup->stack[*nb - 1];
+		child = node->first_child;
+		if (NULL != child) {
+			node->first_child = child->next;
+			PREFETCH(child->next);
+			PREFETCH(child->first_child);
+			return child;
 		}
-		free_lookup_node(node);
-	} else {
-		remove_leaf_element_lookup(lookup,node->element);
+		(*nb)--;
+		free_lookup_node(lookup, &(lookup->nodes), node);
+	}
+	return NULL;
+}
+
+void delete_lookup_tree(struct lookup_table * lookup, struct lookup_node * node)
+{
+	size_t nb = 0;
+	for (; NULL != node; node = next_child_lookup_stack(lookup, &nb)) {
+		if (node->marked)
+			remove_lookup_ptr(lookup, node);
+		if (is_leaf_lookup(node))
+			remove_leaf_element_lookup(lookup, node->element);
+		else
+			push_lookup_stack(lookup, &nb, node);
 	}
 }
 
@@ -183,7 +426,10 @@ void free_lookup(struct lookup_table * lookup)
 	free(lookup->elements);
 	free_leftovers_lookup(lookup);
 	free(lookup->lookup_table);
-	free(lookup->tmp);
+	free(lookup->tmp.intervals);
+	free(lookup->stack);
+	free_lookup_slab(&(lookup->nodes));
+	free_lookup_slab(&(lookup->leaves));
 }
 
 int has_element_lookup(struct lookup_table * lookup, unsigned int element)
@@ -199,75 +445,111 @@ int is_marked_element_lookup(struct lookup_table * lookup, unsigned int element)
 /**
  * @split_lookup_list : splits @old in two on the @cluster on the level @level. puts the second part in new.
  *
+ * @lookup : the lookup table of the lists
  * @old : the lookup list to split, the second part after the split will be removed
  * @new : the lookup list where the second part of @old will be stored
- * @length :  length of @old
  * @level : the value for @new[@cluster].begin and @old[@cluster].end
  * @cluster : the index old will be split on.
  */
-static void split_lookup_list(struct interval *old, struct interval *new,
-				     unsigned int length,
-				     unsigned int level,
-				     unsigned int cluster)
+static void split_lookup_list(struct lookup_table *lookup,
+			      struct lookup_list *old, struct lookup_list *new,
+			      unsigned int level, unsigned int cluster)
 {
-	if (cluster + 1 < length)
-		memset(new + cluster + 1, 0,
-		       (length - cluster - 1) * sizeof(*new));
-	if (cluster) {
-		memcpy(new, old, cluster * sizeof(*old));
-		memset(old, 0, cluster * sizeof(*new));
+	unsigned int position = position_lookup_list(old, cluster), found,
+	    begin = 0, end = 0, nb, kept;
+	found = has_cluster_lookup_list(old, position, cluster);
+	if (found) {
+		begin = old->intervals[position].begin;
+		end = old->intervals[position].end;
 	}
-	new[cluster].end = old[cluster].end;
-	new[cluster].begin = level;
-	old[cluster].end = level;
+	reserve_lookup_list(lookup, new, position + 1);
+	memcpy(new->intervals, old->intervals,
+	       position * sizeof(*old->intervals));
+	new->nb = position + put_interval(new->intervals + position, cluster,
+					  level, end);
+	nb = old->nb - position - found;
+	kept = !(0 == begin && 0 == level);
+	reserve_lookup_list(lookup, old, kept + nb);
+	memmove(old->intervals + kept, old->intervals + position + found,
+		nb * sizeof(*old->intervals));
+	put_interval(old->intervals, cluster, begin, level);
+	old->nb = kept + nb;
 }
 
 /**
  * @merge_lookup_list_first : merge @second_part into @first_part.
  *
+ * @lookup : the lookup table of the lists
  * @first_part : the beginning part to merge, after the call, it will contains the merged list.
  * @second_part : the end part to merge, not modified by the function
- * @length : length of @first_part and @second_part
  * @cluster : the index on which @first_part and @second_part will be merged
  *
  * @remark : @first_part and @second_part must be consecutive
  */
-static void merge_lookup_list_first(struct interval *first_part,
-				     struct interval *second_part,
-				unsigned int length,unsigned int cluster)
+static void merge_lookup_list_first(struct lookup_table *lookup,
+				    struct lookup_list *first_part,
+				    struct lookup_list *second_part,
+				    unsigned int cluster)
 {
-	first_part[cluster].begin = second_part[cluster].begin;
-	if (cluster + 1 < length)
-		memcpy(first_part + cluster + 1, second_part + cluster + 1,
-		       (length - cluster - 1) * sizeof(*first_part));
+	unsigned int first = position_lookup_list(first_part, cluster),
+	    second = position_lookup_list(second_part, cluster), begin = 0,
+	    end = 0, nb;
+	if (has_cluster_lookup_list(first_part, first, cluster))
+		end = first_part->intervals[first].end;
+	if (has_cluster_lookup_list(second_part, second, cluster))
+		begin = second_part->intervals[second++].begin;
+	nb = second_part->nb - second;
+	reserve_lookup_list(lookup, first_part, first + 1 + nb);
+	first += put_interval(first_part->intervals + first, cluster, begin,
+			      end);
+	memcpy(first_part->intervals + first, second_part->intervals + second,
+	       nb * sizeof(*second_part->intervals));
+	first_part->nb = first + nb;
 }
 
 /**
  * @merge_lookup_list_second : merge @first_part into @second_part.
  *
+ * @lookup : the lookup table of the lists
  * @first_part : the beginning part to merge, not modified by the function
- * @second_part : the end part to merge, after the call, it will contains the merged list.* @length : length of @first_part and @second_part
+ * @second_part : the end part to merge, after the call, it will contains the merged list.
  * @cluster : the index on which @first_part and @second_part will be merged
  *
  * @remark : @first_part and @second_part must be consecutive
  */
-static void merge_lookup_list_second(struct interval *first_part,
-					     struct interval *second_part,
-					unsigned int UNUSED(length),unsigned int cluster)
+static void merge_lookup_list_second(struct lookup_table *lookup,
+				     struct lookup_list *first_part,
+				     struct lookup_list *second_part,
+				     unsigned int cluster)
 {
-	second_part[cluster].end = first_part[cluster].end;
-	if (cluster)
-		memcpy(second_part, first_part, cluster * sizeof(*first_part));
+	unsigned int first = position_lookup_list(first_part, cluster),
+	    second = position_lookup_list(second_part, cluster), begin = 0,
+	    end = 0, nb, kept;
+	if (has_cluster_lookup_list(first_part, first, cluster))
+		end = first_part->intervals[first].end;
+	if (has_cluster_lookup_list(second_part, second, cluster))
+		begin = second_part->intervals[second++].begin;
+	nb = second_part->nb - second;
+	kept = !(0 == begin && 0 == end);
+	reserve_lookup_list(lookup, second_part, first + kept + nb);
+	memmove(second_part->intervals + first + kept,
+		second_part->intervals + second,
+		nb * sizeof(*second_part->intervals));
+	memcpy(second_part->intervals, first_part->intervals,
+	       first * sizeof(*first_part->intervals));
+	put_interval(second_part->intervals + first, cluster, begin, end);
+	second_part->nb = first + kept + nb;
 }
 
 void update_splitted_lookup_table(struct lookup_table * lookup,
 					 struct lookup_node * node)
 {
+	struct interval *interval = node->lookup_list.intervals;
 	unsigned int i, j;
-	for (i = 0; i < lookup->k; i++)
-		for (j = node->lookup_list[i].begin;
-		     j < node->lookup_list[i].end; j++)
-			lookup->lookup_table[j * lookup->k + i] = node;
+	for (i = 0; i < node->lookup_list.nb; i++, interval++)
+		for (j = interval->begin; j < interval->end; j++)
+			lookup->lookup_table[j * lookup->k +
+					     interval->cluster] = node;
 }
 
 /**
@@ -287,7 +569,7 @@ static struct lookup_node *split_lookup_node(struct lookup_table * lookup,
 					   unsigned int cluster)
 {
 	struct lookup_node *tmp;
-	tmp = allocate_lookup_node(node->element, lookup->k);
+	tmp = allocate_lookup_node(lookup, &(lookup->nodes), node->element);
 	tmp->parent = node->parent;
 	if (node->parent) {
 		if(!node->previous){
@@ -308,8 +590,8 @@ static struct lookup_node *split_lookup_node(struct lookup_table * lookup,
 	tmp->marked = 1;
 	tmp->lowest = level;
 	tmp->lowest_k=cluster;
-	split_lookup_list(node->lookup_list, tmp->lookup_list, lookup->k,
-				 level, cluster);
+	split_lookup_list(lookup, &(node->lookup_list), &(tmp->lookup_list),
+			  level, cluster);
 	update_splitted_lookup_table(lookup, tmp);
 	return tmp;
 }
@@ -323,12 +605,13 @@ static struct lookup_node *split_lookup_node(struct lookup_table * lookup,
 void update_merged_lookup_table(struct lookup_table * lookup,
 				       struct lookup_node * node)
 {
+	struct interval *interval = node->lookup_list.intervals;
 	unsigned int i, j;
 	struct lookup_node **tmp;
-	for (i = 0; i < lookup->k; i++) {
-		for (j = node->lookup_list[i].begin;
-		     j < node->lookup_list[i].end; j++) {
-			tmp = lookup->lookup_table + j * lookup->k + i;
+	for (i = 0; i < node->lookup_list.nb; i++, interval++) {
+		for (j = interval->begin; j < interval->end; j++) {
+			tmp = lookup->lookup_table + j * lookup->k +
+			    interval->cluster;
 			if(node != *tmp)
 				*tmp = node;
 		}
@@ -347,11 +630,10 @@ static struct lookup_node *merge_unary_lookup_node(struct lookup_table * lookup,
 						 struct lookup_node * node)
 {
 	struct lookup_node *child = node->first_child;
-	merge_lookup_list_first(node->lookup_list, child->lookup_list,
-				lookup->k,node->lowest_k);
-	free(child->lookup_list);
-	child->lookup_list = node->lookup_list;
-	node->lookup_list = NULL;
+	merge_lookup_list_first(lookup, &(node->lookup_list),
+				&(child->lookup_list), node->lowest_k);
+	/* the lookup lists belong to the blocks of the nodes */
+	copy_lookup_list(lookup, &(child->lookup_list), &(node->lookup_list));
 	child->parent = node->parent;
 	if(node->parent){
 		if(!node->previous){
@@ -367,7 +649,7 @@ static struct lookup_node *merge_unary_lookup_node(struct lookup_table * lookup,
 	}
 	child->marked=1;
 	update_merged_lookup_table(lookup, child);
-	free_lookup_node(node);
+	free_lookup_node(lookup, &(lookup->nodes), node);
 	return child;
 }
 
@@ -462,15 +744,25 @@ static void add_lookup_ptr(struct lookup_table * lookup,
 					 unsigned int level,
 					 unsigned int cluster)
 {
+	struct lookup_list *list = &(node->lookup_list);
+	unsigned int position = position_lookup_list(list, cluster);
 	lookup->lookup_table[lookup->k * level + cluster] = node;
 	if (!node->marked) {
 		node->lowest = level;
 		node->lowest_k = cluster;
 		node->marked = 1;
 	}
-	if (0 == node->lookup_list[cluster].end)
-		node->lookup_list[cluster].begin = level;
-	node->lookup_list[cluster].end = level + 1;
+	if (!has_cluster_lookup_list(list, position, cluster)) {
+		reserve_lookup_list(lookup, list, list->nb + 1);
+		memmove(list->intervals + position + 1, list->intervals + position,
+			(list->nb - position) * sizeof(*list->intervals));
+		list->nb++;
+		list->intervals[position].cluster = cluster;
+		list->intervals[position].end = 0;
+	}
+	if (0 == list->intervals[position].end)
+		list->intervals[position].begin = level;
+	list->intervals[position].end = level + 1;
 }
 
 void connect_element_lookup(struct lookup_table * lookup, unsigned int element,
@@ -528,17 +820,19 @@ static void __remove_unmarked_element_lookup(struct lookup_table * lookup,
  */
 static void lookup_list_recluster(struct lookup_table * lookup,
 				  struct lookup_node * node,
-				  struct interval *lookup_list)
+				  struct lookup_list *lookup_list)
 {
 	unsigned int i, element = node->element;
 	while (node != NULL && element == node->element) {
-		merge_lookup_list_second(node->lookup_list, lookup_list,
-						lookup->k,node->lowest_k);
+		merge_lookup_list_second(lookup, &(node->lookup_list),
+					 lookup_list, node->lowest_k);
 		node = node->parent;
 	}
-	for (i = 0; i < lookup->k && lookup_list[i].begin == lookup_list[i].end;
+	for (i = 0; i < lookup_list->nb &&
+	     lookup_list->intervals[i].begin == lookup_list->intervals[i].end;
 	     i++) ;
-	lookup_list[i].end = lookup->nb_level;
+	if (i < lookup_list->nb)
+		lookup_list->intervals[i].end = lookup->nb_level;
 }
 
 /**
@@ -556,22 +850,19 @@ static void extract_lookup_tree_leaves(struct lookup_table * lookup,
 				       unsigned int array[],
 				       unsigned int *nb_elements)
 {
-	struct lookup_node *tmp;
-	if (node->marked)
-		remove_lookup_ptr(lookup, node);
-	if (is_leaf_lookup(node)) {
-		reset_lookup_node(node, lookup->k);
-		array[*nb_elements] = node->element;
-		(*nb_elements)++;
-		remove_element_leftovers(lookup, node->element);
-		return;
-	}
-	while(node->first_child){
-		tmp=node->first_child;
-		node->first_child=node->first_child->next;
-		extract_lookup_tree_leaves(lookup, tmp, array,nb_elements);
+	size_t nb = 0;
+	/* the nodes are visited in the order of a recursion on the children */
+	for (; NULL != node; node = next_child_lookup_stack(lookup, &nb)) {
+		if (node->marked)
+			remove_lookup_ptr(lookup, node);
+		if (is_leaf_lookup(node)) {
+			reset_lookup_node(node);
+			array[*nb_elements] = node->element;
+			(*nb_elements)++;
+			remove_element_leftovers(lookup, node->element);
+		} else
+			push_lookup_stack(lookup, &nb, node);
 	}
-	free_lookup_node(node);
 }
 
 /**
@@ -680,23 +971,25 @@ static void __remove_marked_element_lookup(struct lookup_table * lookup,
 					   unsigned int array[],
 					   unsigned int *nb_elements)
 {
-	struct interval *lookup_list = lookup->tmp;
+	struct lookup_list *lookup_list = &(lookup->tmp);
+	struct interval *interval;
 	unsigned int i, j, lowest;
 	struct lookup_node *parent;
-	memcpy(lookup_list, node->lookup_list,
-	       sizeof(*lookup_list) * lookup->k);
+	copy_lookup_list(lookup, lookup_list, &(node->lookup_list));
 	parent = node->parent;
 	*nb_elements = 0;
 	if (NULL != parent && parent->element == node->element)
 		lookup_list_recluster(lookup, parent, lookup_list);
 	lowest = lookup->nb_level;
-	for (i = 0; i < lookup->k; i++) {
-		if (lookup_list[i].begin != lookup_list[i].end) {
-			lowest = lookup_list[i].begin;
-			for (j = lookup_list[i].end; j > lookup_list[i].begin;) {
+	for (i = 0; i < lookup_list->nb; i++) {
+		interval = lookup_list->intervals + i;
+		if (interval->begin != interval->end) {
+			lowest = interval->begin;
+			for (j = interval->end; j > interval->begin;) {
 				j--;
-				extract_clusters_level_lookup(lookup, j, i, array,
-							 nb_elements);
+				extract_clusters_level_lookup(lookup, j,
+							      interval->cluster,
+							      array, nb_elements);
 			}
 		}
 	}
@@ -743,12 +1036,12 @@ unsigned int get_nb_clusters_lookup(struct lookup_table * lookup,
 unsigned int get_cluster_lookup(struct lookup_table * lookup, unsigned int level,
 				unsigned int element)
 {
+	struct lookup_list *clusters = lookup->elements[element].clusters;
 	unsigned int i;
-	struct lookup_info *tmp = lookup->elements + element;
-	for (i = 0; i < lookup->k; i++)
-		if (tmp->clusters[i].begin <= level
-		    && tmp->clusters[i].end > level)
-			return i;
+	for (i = 0; i < clusters->nb; i++)
+		if (clusters->intervals[i].begin <= level
+		    && clusters->intervals[i].end > level)
+			return clusters->intervals[i].cluster;
 	return lookup->k;
 }
 
@@ -756,12 +1049,11 @@ void compute_cluster_element_lookup(struct lookup_table * lookup, unsigned int e
 {
 	struct lookup_info *tmp = lookup->elements + element;
 	struct lookup_node *node;
-	memcpy(tmp->clusters, tmp->leaf->lookup_list,
-	       sizeof(*tmp->clusters) * lookup->k);
+	copy_lookup_list(lookup, tmp->clusters, &(tmp->leaf->lookup_list));
 	node = tmp->leaf->parent;
 	while (node) {
-		merge_lookup_list_second(node->lookup_list,
-						tmp->clusters, lookup->k,node->lowest_k);
+		merge_lookup_list_second(lookup, &(node->lookup_list),
+					 tmp->clusters, node->lowest_k);
 		node = node->parent;
 	}
 }
@@ -1,27 +1,44 @@
 #ifndef __HEADER_LOOKUP_STRUCTURE__
 #define __HEADER_LOOKUP_STRUCTURE__
 
+#include <stddef.h>
+
 /**
- * @struct interval : represent an interval
+ * @struct interval : represent the interval of levels of a cluster
  *
+ * @cluster : index of the cluster
  * @begin : beginning of the interval
  * @end : end of interval
  */
 struct interval {
+	unsigned int cluster;
 	unsigned int begin;
 	unsigned int end;
 };
 
+/**
+ * @struct lookup_list : sparse list of the intervals of levels of clusters, sorted by cluster, a missing cluster having the interval [0, 0)
+ *
+ * @intervals : the intervals
+ * @nb : number of intervals
+ * @max : allocated size of @intervals, the list being stored in the block of its node while it is at most lookup_table.max_inline
+ */
+struct lookup_list {
+	struct interval *intervals;
+	unsigned int nb;
+	unsigned int max;
+};
+
 struct lookup_node;
 
 /**
  * @struct lookup_info : list of clusters and pointer to the leaf node of an element
  *
- * @clusters : the list of clusters of the element
+ * @clusters : the list of clusters of the element, in the block of its leaf
  * @leaf : the leaf node of the element
  */
 struct lookup_info {
-	struct interval *clusters;
+	struct lookup_list *clusters;
 	struct lookup_node *leaf;
 };
 
@@ -42,7 +59,7 @@ struct lookup_info {
  * @remark : the last child of a node must have the same center.
  */
 struct lookup_node {
-	struct interval *lookup_list;
+	struct lookup_list lookup_list;
 	struct lookup_node *parent;
 	struct lookup_node *first_child;
 	struct lookup_node *previous;
@@ -83,6 +100,30 @@ struct leftovers_ptr {
  */
 #define INIT_LEFTOVERS_SIZE 100
 
+/**
+ * Number of blocks of a chunk of a lookup slab
+ */
+#define LOOKUP_SLAB_BLOCKS 64
+
+/**
+ * @struct lookup_slab : blocks of the same size, each holding a node followed by the intervals of its lists, carved out of chunks that are only freed with the slab
+ *
+ * @chunks : the chunks, LOOKUP_SLAB_BLOCKS blocks each
+ * @nb_chunks : number of chunks allocated
+ * @max_chunks : size of @chunks
+ * @block_size : number of bytes of a block
+ * @nb_carved : number of blocks of the last chunk handed out at least once
+ * @free_blocks : list of the blocks given back, the first bytes of a free block pointing to the next one
+ */
+struct lookup_slab {
+	unsigned char **chunks;
+	size_t nb_chunks;
+	size_t max_chunks;
+	size_t block_size;
+	unsigned int nb_carved;
+	void *free_blocks;
+};
+
 /**
  * @struct lookup_table : structure representing a packed group of levels.
  *
@@ -93,7 +134,12 @@ struct leftovers_ptr {
  * @range_elements : specify the range of the index of the elements (from 0 to @range_element -1).
  * @leftovers : array of nb_level + 1 leftovers (highest = element inserted in no level). if an element is in @leftovers[i], it means that it left the leftovers cluster on level i.
  * @leftovers_ptr : leftovers_ptr for all elements
- * @tmp : small array of length @k used by some function
+ * @tmp : list of up to @k intervals used by some function
+ * @max_inline : number of intervals of a list stored in the block of its node, longer lists being allocated apart
+ * @stack : nodes whose children are being walked through, used instead of recursion by the traversals that free the trees
+ * @max_stack : allocated size of @stack
+ * @nodes : slab of the internal nodes, each with its lookup list
+ * @leaves : slab of the leaves, each with its lookup list and the clusters of its element
  */
 struct lookup_table{
 	struct lookup_node **lookup_table;
@@ -103,7 +149,12 @@ struct lookup_table{
 	unsigned int range_elements;
 	struct leftovers *leftovers;
 	struct leftovers_ptr *leftovers_ptr;
-	struct interval *tmp;
+	struct lookup_list tmp;
+	unsigned int max_inline;
+	struct lookup_node **stack;
+	size_t max_stack;
+	struct lookup_slab nodes;
+	struct lookup_slab leaves;
 };
 
 /**
@@ -128,6 +179,14 @@ void initialise_lookup(struct lookup_table * lookup, unsigned int k,
  */
 void free_lookup(struct lookup_table * lookup);
 
+/**
+ * @resize_lookup : let @lookup hold the elements from 0 to @range_elements - 1, keeping its content
+ *
+ * @lookup : the lookup table to resize
+ * @range_elements : the new range of the elements, at least the current one
+ */
+void resize_lookup(struct lookup_table * lookup, unsigned int range_elements);
+
 /**
  * @is_leaf_lookup : check if @node is a leaf
  *
@@ -137,6 +196,27 @@ void free_lookup(struct lookup_table * lookup);
  */
 int is_leaf_lookup(struct lookup_node * node);
 
+/**
+ * @first_leaf_lookup : gives the first leaf of the tree with root @root
+ *
+ * @root : the root of the tree
+ *
+ * @return the first leaf, @root itself if it is a leaf
+ */
+struct lookup_node *first_leaf_lookup(struct lookup_node * root);
+
+/**
+ * @next_leaf_lookup : gives the leaf following @leaf in the tree with root @root
+ *
+ * @root : the root of the tree
+ * @leaf : a leaf of the tree
+ *
+ * @return the next leaf, NULL if @leaf is the last one
+ * @remark : the leaves are walked through with the parent links, so that the depth of the tree costs no memory
+ */
+struct lookup_node *next_leaf_lookup(struct lookup_node * root,
+				     struct lookup_node * leaf);
+
 /**
  * @has_element_lookup : check if @element has a leaf in @lookup
  *
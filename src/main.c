@@ -13,6 +13,9 @@ Main module
 #include "algo_fully_adv.h"
 #include "algo_packed.h"
 #include "algo_trajectories.h"
+#include "center_grid.h"
+#include "binary_dataset.h"
+#include "operation_stream.h"
 
 #include <stdlib.h>
 #include <time.h>
@@ -42,24 +45,47 @@ struct program_args {
 	Algo_type algo;		/* algo type asked */
 	int parallel;		/* multithread asked by user */
 	unsigned int nb_thread;	/* nb of thread asked by user */
+	unsigned int nb_parse_thread;	/* nb of thread parsing the data file */
 	unsigned int cluster_size;	/* limit of cluster size specified by user */
+	int grid;		/* spatial index of centers asked by user */
+	int element_major;	/* membership of the elements in all levels stored together */
+	Metric_type metric;	/* distance asked by user */
+	int operations;		/* data file given as a stream of operations */
+	unsigned int seed;	/* seed of the order of the reinsertions */
 };
 
 void help(void)
 {
 	fprintf(stderr,
-		"Sliding window: %s -s [-l log_file] k eps window_size d_min d_max data_file\n",
+		"Sliding window: %s -s [-l log_file -g -e] k eps window_size d_min d_max data_file\n",
 		prog_name);
 	fprintf(stderr,
-		"Fully adversary: %s -m [-l log_file] k eps d_min d_max data_file query_file\n",
+		"Fully adversary: %s -m [-l log_file -i nb_threads -g -j -e] k eps d_min d_max data_file query_file\n",
 		prog_name);
 	fprintf(stderr,
-		"Packed Fully adversary: %s -o [-l log_file] k eps d_min d_max data_file query_file\n",
+		"Packed Fully adversary: %s -o [-l log_file -i nb_threads -e] k eps d_min d_max data_file query_file\n",
 		prog_name);
 	fprintf(stderr,
-		"Fully adversary Trajectories: %s -p [-l log_file -n nb_threads] k eps d_min d_max data_file query_file\n",
+		"Fully adversary on a stream of operations: %s -m|-o -f [-l log_file -g -j -e] k eps d_min d_max operation_file\n",
 		prog_name);
-
+	fprintf(stderr,
+		"Fully adversary Trajectories: %s -p [-l log_file -n nb_threads -i nb_threads -e] k eps d_min d_max data_file query_file\n",
+		prog_name);
+	fprintf(stderr,
+		"-n runs the levels of -p in parallel on nb_threads threads\n");
+	fprintf(stderr,
+		"-i parses the data file with nb_threads threads\n");
+	fprintf(stderr,
+		"-s reads its data file as a stream, - being the standard input, and only keeps the points of the window\n");
+	fprintf(stderr,
+		"-g indexes centers in a spatial grid, always done when k >= %d\n",
+		CENTER_GRID_MIN_K);
+	fprintf(stderr,
+		"-j keeps the clusters of an element in all levels of -m in a single row, with 16-bit cluster indices\n");
+	fprintf(stderr,
+		"-e uses great-circle distances, d_min and d_max are then in metres instead of degrees\n");
+	fprintf(stderr,
+		"-r seed seeds the random order of the reinsertions after a deletion, to replay a stream of kcenter-gen -a\n");
 }
 
 double n_log_n(double n)
@@ -75,6 +101,13 @@ void init_prog_args(struct program_args *prog_args)
 	prog_args->long_log = 0;
 	prog_args->window_length = 0;
 	prog_args->parallel = 0;
+	prog_args->nb_thread = 1;
+	prog_args->nb_parse_thread = 1;
+	prog_args->grid = 0;
+	prog_args->element_major = 0;
+	prog_args->metric = EUCLIDEAN_METRIC;
+	prog_args->operations = 0;
+	prog_args->seed = (unsigned int)time(NULL);
 	prog_args->log_file[0] = '\0';
 }
 
@@ -82,7 +115,7 @@ int __parse_options(int argc, char *argv[], struct program_args *prog_args)
 {
 	Error_enum tmp;
 	int opt;
-	while ((opt = getopt(argc, argv, "hvl:tsmpn:bc:u:o")) != -1) {
+	while ((opt = getopt(argc, argv, "hvl:tsmpn:i:bc:u:ogjefr:")) != -1) {
 		switch (opt) {
 		case 'u':
 			enable_time_log(optarg);
@@ -108,6 +141,18 @@ int __parse_options(int argc, char *argv[], struct program_args *prog_args)
 		case 'p':
 			prog_args->algo = TRAJECTORIES_K_CENTER;
 			break;
+		case 'g':
+			prog_args->grid = 1;
+			break;
+		case 'j':
+			prog_args->element_major = 1;
+			break;
+		case 'e':
+			prog_args->metric = GREAT_CIRCLE_METRIC;
+			break;
+		case 'f':
+			prog_args->operations = 1;
+			break;
 		case 'n':
 			prog_args->parallel = 1;
 			tmp = strtoui_wrapper(optarg, &prog_args->nb_thread);
@@ -117,6 +162,22 @@ int __parse_options(int argc, char *argv[], struct program_args *prog_args)
 				exit(EXIT_FAILURE);
 			}
 			break;
+		case 'i':
+			tmp = strtoui_wrapper(optarg,
+					      &prog_args->nb_parse_thread);
+			if (tmp || 0 == prog_args->nb_parse_thread) {
+				fprintf(stderr,
+					"Positive number of thread required for -i option");
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'r':
+			if (strtoui_wrapper(optarg, &prog_args->seed)) {
+				fprintf(stderr,
+					"Unsigned seed required for -r option\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case 'c':
 			tmp = strtoui_wrapper(optarg, &prog_args->cluster_size);
 			if (tmp || 0 == prog_args->cluster_size) {
@@ -142,7 +203,13 @@ int parse_options(int argc, char *argv[], struct program_args *prog_args)
 	init_prog_args(prog_args);
 	if (__parse_options(argc, argv, prog_args))
 		return 1;
-	if (argc - optind != 6) {
+	if (prog_args->operations && prog_args->algo != FULLY_ADV_K_CENTER
+	    && prog_args->algo != PACKED_K_CENTER) {
+		fprintf(stderr, "-f requires -m or -o\n");
+		help();
+		exit(EXIT_FAILURE);
+	}
+	if (argc - optind != (prog_args->operations ? 5 : 6)) {
 		help();
 		exit(EXIT_FAILURE);
 	}
@@ -151,6 +218,8 @@ int parse_options(int argc, char *argv[], struct program_args *prog_args)
 		help();
 		exit(EXIT_FAILURE);
 	}
+	if (prog_args->k >= CENTER_GRID_MIN_K)
+		prog_args->grid = 1;
 	next_arg++;
 	if (strtod_wrapper(argv[optind + next_arg], &prog_args->epsilon)
 	    || 0 >= prog_args->epsilon) {
@@ -185,9 +254,10 @@ int parse_options(int argc, char *argv[], struct program_args *prog_args)
 	next_arg++;
 	prog_args->points_path = argv[optind + next_arg];
 	next_arg++;
-	if (prog_args->algo == FULLY_ADV_K_CENTER
-	    || prog_args->algo == TRAJECTORIES_K_CENTER
-	    || prog_args->algo == PACKED_K_CENTER) {
+	if (!prog_args->operations
+	    && (prog_args->algo == FULLY_ADV_K_CENTER
+		|| prog_args->algo == TRAJECTORIES_K_CENTER
+		|| prog_args->algo == PACKED_K_CENTER)) {
 		prog_args->queries_path = argv[optind + next_arg];
 	}
 	printf("k: %d eps: %lf d_min: %lf d_max: %lf\n", prog_args->k,
@@ -198,62 +268,180 @@ int parse_options(int argc, char *argv[], struct program_args *prog_args)
 void sliding_k_center(struct program_args *prog_args)
 {
 	Sliding_level *levels;
-	void *array;
-	unsigned int size, nb_instances;
-	sliding_import_points(&array, &size, prog_args->points_path,
-			      prog_args->window_length);
-	printf("import ended!\n");
+	struct sliding_window window;
+	struct sliding_stream stream;
+	unsigned int nb_instances;
+	if (sliding_open_stream(&stream, prog_args->points_path,
+				prog_args->window_length))
+		exit(EXIT_FAILURE);
+	sliding_initialise_window(&window);
 	sliding_initialise_levels_array(&levels, prog_args->k,
 					prog_args->epsilon, prog_args->d_min,
-					prog_args->d_max, &nb_instances, array,
-					size);
-	sliding_k_center_run(levels, nb_instances);
-	free(array);
+					prog_args->d_max, &nb_instances,
+					&window, prog_args->grid);
+	sliding_k_center_run(levels, nb_instances, &stream);
+	sliding_close_stream(&stream);
+	sliding_free_window(&window);
 	sliding_delete_levels_array(levels, nb_instances);
+	if (stream.error)
+		exit(EXIT_FAILURE);
+}
+
+void open_queries(struct query_provider *queries, char *path,
+		  unsigned int nb_elements)
+{
+	if (initialise_query_provider(queries, path))
+		exit(EXIT_FAILURE);
+	if (queries->range > nb_elements) {
+		fprintf(stderr,
+			"%s refers to %u elements but the data file has %u\n",
+			path, queries->range, nb_elements);
+		exit(EXIT_FAILURE);
+	}
 }
 
 void fully_adv_k_center(struct program_args *prog_args)
 {
 	Fully_adv_cluster *clusters_array;
 	void *array;
+	Unit_vector *units;
 	struct query_provider queries;
+	struct set_membership membership;
 	unsigned int size, nb_instances;
 	unsigned int *helper_array;
-	fully_adv_import_points(&array, &size, prog_args->points_path);
+	Error_enum tmp;
+	if (is_dataset_file(prog_args->points_path))
+		tmp = dataset_import_points(&array, &size,
+					    prog_args->points_path);
+	else
+		tmp = fully_adv_import_points(&array, &size,
+					      prog_args->points_path,
+					      prog_args->nb_parse_thread);
+	if (tmp)
+		exit(EXIT_FAILURE);
 	printf("import ended!\n");
-	initialise_query_provider(&queries, prog_args->queries_path);
+	open_queries(&queries, prog_args->queries_path, size);
 	if (0 == prog_args->cluster_size)
 		prog_args->cluster_size = size;
+	units = unit_vector_array(array, size);
+	if (prog_args->element_major)
+		initialise_set_membership(&membership,
+					  fully_adv_nb_instances(prog_args->
+								 epsilon,
+								 prog_args->
+								 d_min,
+								 prog_args->
+								 d_max),
+					  prog_args->k + 1, size);
 	fully_adv_initialise_level_array(&clusters_array, prog_args->k,
 					 prog_args->epsilon, prog_args->d_min,
 					 prog_args->d_max, &nb_instances, array,
-					 size, prog_args->cluster_size,
-					 &helper_array);
+					 units, size, prog_args->cluster_size,
+					 &helper_array, prog_args->grid,
+					 prog_args->element_major ? &membership :
+					 NULL);
 	fully_adv_k_center_run(clusters_array, nb_instances, &queries,
 			       helper_array);
 	free(array);
+	free(units);
 	fully_adv_delete_level_array(clusters_array, nb_instances,
 				     helper_array);
+	if (prog_args->element_major)
+		free_set_membership(&membership);
 	free_query_provider(&queries);
+	if (queries.error)
+		exit(EXIT_FAILURE);
+}
+
+void fully_adv_operations_k_center(struct program_args *prog_args)
+{
+	Fully_adv_cluster *clusters_array;
+	struct operation_stream stream;
+	struct set_membership membership;
+	unsigned int *helper_array, nb_instances;
+	open_operation_stream(&stream, prog_args->points_path);
+	if (0 == prog_args->cluster_size)
+		prog_args->cluster_size = (unsigned int)stream.range;
+	if (prog_args->element_major)
+		initialise_set_membership(&membership,
+					  fully_adv_nb_instances(prog_args->
+								 epsilon,
+								 prog_args->
+								 d_min,
+								 prog_args->
+								 d_max),
+					  prog_args->k + 1,
+					  (unsigned int)stream.range);
+	fully_adv_initialise_level_array(&clusters_array, prog_args->k,
+					 prog_args->epsilon, prog_args->d_min,
+					 prog_args->d_max, &nb_instances,
+					 stream.points, stream.units,
+					 (unsigned int)stream.range,
+					 MIN(prog_args->cluster_size,
+					     (unsigned int)stream.range),
+					 &helper_array, prog_args->grid,
+					 prog_args->element_major ? &membership :
+					 NULL);
+	fully_adv_k_center_stream(clusters_array, nb_instances, &stream,
+				  &helper_array);
+	fully_adv_delete_level_array(clusters_array, nb_instances,
+				     helper_array);
+	if (prog_args->element_major)
+		free_set_membership(&membership);
+	close_operation_stream(&stream);
+	if (stream.error)
+		exit(EXIT_FAILURE);
 }
 
 void packed_k_center(struct program_args *prog_args)
 {
 	Packed_level *levels;
 	void *array;
+	Unit_vector *units;
 	struct query_provider queries;
 	unsigned int size, nb_instances;
-	packed_import_points(&array, &size, prog_args->points_path);
+	Error_enum tmp;
+	if (is_dataset_file(prog_args->points_path))
+		tmp = dataset_import_points(&array, &size,
+					    prog_args->points_path);
+	else
+		tmp = packed_import_points(&array, &size,
+					   prog_args->points_path,
+					   prog_args->nb_parse_thread);
+	if (tmp)
+		exit(EXIT_FAILURE);
 	printf("import ended!\n");
-	initialise_query_provider(&queries, prog_args->queries_path);
+	open_queries(&queries, prog_args->queries_path, size);
+	units = unit_vector_array(array, size);
 	packed_initialise_levels_array(&levels, prog_args->k,
 				       prog_args->epsilon, prog_args->d_min,
 				       prog_args->d_max, &nb_instances, array,
-				       size);
+				       units, size);
 	packed_k_center_run(levels, nb_instances, &queries);
 	free(array);
+	free(units);
 	packed_free_levels_array(levels, nb_instances);
 	free_query_provider(&queries);
+	if (queries.error)
+		exit(EXIT_FAILURE);
+}
+
+void packed_operations_k_center(struct program_args *prog_args)
+{
+	Packed_level *levels;
+	struct operation_stream stream;
+	unsigned int nb_instances;
+	open_operation_stream(&stream, prog_args->points_path);
+	packed_initialise_levels_array(&levels, prog_args->k,
+				       prog_args->epsilon, prog_args->d_min,
+				       prog_args->d_max, &nb_instances,
+				       stream.points, stream.units,
+				       (unsigned int)stream.range);
+	packed_k_center_stream(levels, nb_instances, &stream);
+	packed_free_levels_array(levels, nb_instances);
+	close_operation_stream(&stream);
+	if (stream.error)
+		exit(EXIT_FAILURE);
 }
 
 void trajectories_k_center(struct program_args *prog_args)
@@ -262,9 +450,18 @@ void trajectories_k_center(struct program_args *prog_args)
 	Trajectory *array;
 	struct query_provider queries;
 	unsigned int size, *helper_array, nb_instances;
-	trajectories_import_points(&array, &size, prog_args->points_path);
+	Error_enum tmp;
+	if (is_dataset_file(prog_args->points_path))
+		tmp = dataset_import_trajectories(&array, &size,
+						  prog_args->points_path);
+	else
+		tmp = trajectories_import_points(&array, &size,
+						 prog_args->points_path,
+						 prog_args->nb_parse_thread);
+	if (tmp)
+		exit(EXIT_FAILURE);
 	printf("import ended!\n");
-	initialise_query_provider(&queries, prog_args->queries_path);
+	open_queries(&queries, prog_args->queries_path, size);
 	trajectories_initialise_level_array(&clusters_array, prog_args->k,
 					    prog_args->epsilon,
 					    prog_args->d_min, prog_args->d_max,
@@ -275,6 +472,8 @@ void trajectories_k_center(struct program_args *prog_args)
 	trajectories_delete_level_array(clusters_array, nb_instances,
 					helper_array);
 	free_query_provider(&queries);
+	if (queries.error)
+		exit(EXIT_FAILURE);
 	trajectories_delete_points(array);
 }
 
@@ -283,9 +482,18 @@ void trajectories_parallel_k_center(struct program_args *prog_args)
 	Trajectory *array;
 	struct query_provider queries;
 	unsigned int size;
-	trajectories_import_points(&array, &size, prog_args->points_path);
+	Error_enum tmp;
+	if (is_dataset_file(prog_args->points_path))
+		tmp = dataset_import_trajectories(&array, &size,
+						  prog_args->points_path);
+	else
+		tmp = trajectories_import_points(&array, &size,
+						 prog_args->points_path,
+						 prog_args->nb_parse_thread);
+	if (tmp)
+		exit(EXIT_FAILURE);
 	printf("import ended!\n");
-	initialise_query_provider(&queries, prog_args->queries_path);
+	open_queries(&queries, prog_args->queries_path, size);
 	trajectories_parallel_initialise_level_array(prog_args->k,
 						     prog_args->epsilon,
 						     prog_args->d_min,
@@ -295,6 +503,8 @@ void trajectories_parallel_k_center(struct program_args *prog_args)
 	trajectories_parallel_k_center_run(&queries);
 	trajectories_parallel_delete_level_array();
 	free_query_provider(&queries);
+	if (queries.error)
+		exit(EXIT_FAILURE);
 	trajectories_delete_points(array);
 }
 
@@ -302,9 +512,10 @@ int main(int argc, char *argv[])
 {
 	struct program_args prog_args;
 	srand48(time(NULL));
-	srand((unsigned int)time(NULL));
 	if (parse_options(argc, argv, &prog_args))
 		return 0;
+	srand(prog_args.seed);
+	set_metric(prog_args.metric);
 	if (prog_args.long_log)
 		enable_long_log(prog_args.log_file);
 	else
@@ -316,11 +527,17 @@ int main(int argc, char *argv[])
 		break;
 	case FULLY_ADV_K_CENTER:
 		printf("Fully adversary algorithm chosen\n");
-		fully_adv_k_center(&prog_args);
+		if (prog_args.operations)
+			fully_adv_operations_k_center(&prog_args);
+		else
+			fully_adv_k_center(&prog_args);
 		break;
 	case PACKED_K_CENTER:
 		printf("Packed fully adversary algorithm chosen\n");
-		packed_k_center(&prog_args);
+		if (prog_args.operations)
+			packed_operations_k_center(&prog_args);
+		else
+			packed_k_center(&prog_args);
 		break;
 	case TRAJECTORIES_K_CENTER:
 		printf("Trajectories fully adversary algorithm chosen\n");
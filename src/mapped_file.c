@@ -0,0 +1,382 @@
+/**
+This module maps the input files in memory and parses their fields in place, a line being a list of fields separated by spaces, tabulations or commas
+**/
+#include "mapped_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+/**
+ * Longest number parsed through a copy, which only happens for the last field of a file without final newline
+ */
+#define NUMBER_BUFFER_SIZE 64
+
+/**
+ * Largest mantissa exactly representable as a double
+ */
+#define EXACT_MANTISSA_MAX ((uint64_t) 1 << 53)
+
+/**
+ * Largest power of ten exactly representable as a double
+ */
+#define EXACT_POWER_MAX 22
+
+/**
+ * Most significant digits read before giving up on the fast path, so that the mantissa can not overflow
+ */
+#define FAST_DIGITS_MAX 19
+
+static const double powers_of_ten[EXACT_POWER_MAX + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+	1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define IS_SEPARATOR(c) (' ' == (c) || '\t' == (c) || ',' == (c) || '\r' == (c))
+
+void map_file(struct mapped_file *file, char *path)
+{
+	struct stat info;
+	int fd = open_wrapper(path, O_RDONLY);
+	if (-1 == fstat(fd, &info)) {
+		perror("fstat");
+		exit(EXIT_FAILURE);
+	}
+	file->size = (size_t)info.st_size;
+	file->data = NULL;
+	if (file->size) {
+		file->data =
+		    mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (MAP_FAILED == file->data) {
+			perror("mmap");
+			exit(EXIT_FAILURE);
+		}
+	}
+	close_wrapper(fd);
+}
+
+void unmap_file(struct mapped_file *file)
+{
+	if (file->data && -1 == munmap(file->data, file->size)) {
+		perror("munmap");
+		exit(EXIT_FAILURE);
+	}
+	file->data = NULL;
+	file->size = 0;
+}
+
+size_t count_lines(char *begin, char *end)
+{
+	size_t nb = 0;
+	char *newline;
+	while (begin < end) {
+		newline = memchr(begin, '\n', (size_t)(end - begin));
+		nb++;
+		if (!newline)
+			break;
+		begin = newline + 1;
+	}
+	return nb;
+}
+
+char *next_line(char *cursor, char *end)
+{
+	char *newline;
+	if (cursor >= end)
+		return end;
+	newline = memchr(cursor, '\n', (size_t)(end - cursor));
+	return newline ? newline + 1 : end;
+}
+
+/**
+ * @field_bounds : move @cursor to the beginning of the next field of the line and set @stop after its last character
+ *
+ * @return 1 if there is a field, 0 at the end of the line
+ */
+static int field_bounds(char **cursor, char *end, char **stop)
+{
+	char *current = *cursor;
+	while (current < end && IS_SEPARATOR(*current))
+		current++;
+	*cursor = current;
+	while (current < end && '\n' != *current && !IS_SEPARATOR(*current))
+		current++;
+	*stop = current;
+	return current != *cursor;
+}
+
+Error_enum skip_field(char **cursor, char *end)
+{
+	char *stop;
+	if (!field_bounds(cursor, end, &stop))
+		return FILE_FORMAT_ERROR;
+	*cursor = stop;
+	return NO_ERROR;
+}
+
+Error_enum check_end_of_line(char **cursor, char *end)
+{
+	char *stop;
+	return field_bounds(cursor, end, &stop) ? FILE_FORMAT_ERROR : NO_ERROR;
+}
+
+Error_enum parse_unsigned_field(char **cursor, char *end,
+				unsigned int *value)
+{
+	char *current, *stop;
+	unsigned int digit;
+	if (!field_bounds(cursor, end, &stop))
+		return FILE_FORMAT_ERROR;
+	*value = 0;
+	for (current = *cursor; current < stop; current++) {
+		if (*current < '0' || *current > '9')
+			return FILE_FORMAT_ERROR;
+		digit = (unsigned int)(*current - '0');
+		if (*value > (UINT_MAX - digit) / 10)
+			return FILE_FORMAT_ERROR;
+		*value = *value * 10 + digit;
+	}
+	*cursor = stop;
+	return NO_ERROR;
+}
+
+/**
+ * @fast_decimal : convert the number between @begin and @stop when it is written [-+]ddd.ddd with a mantissa and a power of ten both exact doubles, their quotient being then correctly rounded as by strtod
+ *
+ * @return 1 if the number was converted, 0 if it must be given to strtod
+ */
+static int fast_decimal(char *begin, char *stop, double *value)
+{
+	uint64_t mantissa = 0;
+	unsigned int nb_digits = 0, nb_decimals = 0;
+	int negative = 0, point = 0, digit_seen = 0;
+	char *current = begin;
+	if ('-' == *current || '+' == *current) {
+		negative = '-' == *current;
+		current++;
+	}
+	for (; current < stop; current++) {
+		if ('.' == *current && !point) {
+			point = 1;
+			continue;
+		}
+		if (*current < '0' || *current > '9')
+			return 0;
+		digit_seen = 1;
+		if (mantissa || '0' != *current)
+			nb_digits++;
+		if (nb_digits > FAST_DIGITS_MAX)
+			return 0;
+		mantissa = mantissa * 10 + (uint64_t) (*current - '0');
+		nb_decimals += (unsigned int)point;
+	}
+	if (!digit_seen || mantissa > EXACT_MANTISSA_MAX
+	    || nb_decimals > EXACT_POWER_MAX)
+		return 0;
+	*value = (double)mantissa / powers_of_ten[nb_decimals];
+	if (negative)
+		*value = -*value;
+	return 1;
+}
+
+Error_enum parse_double_field(char **cursor, char *end, double *value)
+{
+	char buffer[NUMBER_BUFFER_SIZE];
+	char *stop, *error;
+	size_t length;
+	if (!field_bounds(cursor, end, &stop))
+		return FILE_FORMAT_ERROR;
+	if (fast_decimal(*cursor, stop, value)) {
+		*cursor = stop;
+		return NO_ERROR;
+	}
+	errno = 0;
+	if (stop < end) {
+		/* the separator after the field stops strtod */
+		*value = strtod(*cursor, &error);
+	} else {
+		length = (size_t)(stop - *cursor);
+		if (length >= NUMBER_BUFFER_SIZE)
+			return FILE_FORMAT_ERROR;
+		memcpy(buffer, *cursor, length);
+		buffer[length] = '\0';
+		*value = strtod(buffer, &error);
+		error = *cursor + (error - buffer);
+	}
+	if (error != stop || 0 != errno)
+		return FILE_FORMAT_ERROR;
+	*cursor = stop;
+	return NO_ERROR;
+}
+
+Error_enum parse_geo_point_fields(char **cursor, char *end,
+				  Geo_point * point)
+{
+	double longitude, latitude;
+	if (parse_double_field(cursor, end, &longitude)
+	    || parse_double_field(cursor, end, &latitude))
+		return FILE_FORMAT_ERROR;
+	point->longitude = (Coordinate) longitude;
+	point->latitude = (Coordinate) latitude;
+	return NO_ERROR;
+}
+
+/**
+ * @run_chunks : run @work on every chunk of @lines, the first one in the calling thread and the others in their own threads
+ */
+static void run_chunks(struct chunked_lines *lines, void *(*work) (void *))
+{
+	unsigned int i;
+	pthread_t *threads;
+	if (1 == lines->nb_chunks) {
+		work(lines->chunks);
+		return;
+	}
+	threads = malloc_wrapper(sizeof(*threads) * lines->nb_chunks);
+	for (i = 1; i < lines->nb_chunks; i++)
+		if (pthread_create(threads + i, NULL, work, lines->chunks + i)) {
+			perror("Can not create thread !");
+			exit(EXIT_FAILURE);
+		}
+	work(lines->chunks);
+	for (i = 1; i < lines->nb_chunks; i++)
+		if (pthread_join(threads[i], NULL)) {
+			perror("Can not join thread !");
+			exit(EXIT_FAILURE);
+		}
+	free(threads);
+}
+
+/**
+ * @first_error : gives the first error of the chunks of @lines and the index of its line
+ */
+static Error_enum first_error(struct chunked_lines *lines, size_t *error_line)
+{
+	unsigned int i;
+	for (i = 0; i < lines->nb_chunks; i++)
+		if (lines->chunks[i].error) {
+			*error_line = lines->chunks[i].first_line +
+			    lines->chunks[i].error_line;
+			return lines->chunks[i].error;
+		}
+	return NO_ERROR;
+}
+
+/**
+ * @count_chunk : count the lines and items of a chunk
+ */
+static void *count_chunk(void *argument)
+{
+	struct line_chunk *chunk = argument;
+	line_counter counter = chunk->lines->counter;
+	char *cursor;
+	size_t nb_items;
+	chunk->error = NO_ERROR;
+	if (!counter) {
+		chunk->nb_lines = count_lines(chunk->begin, chunk->end);
+		chunk->nb_items = chunk->nb_lines;
+		return NULL;
+	}
+	chunk->nb_lines = 0;
+	chunk->nb_items = 0;
+	for (cursor = chunk->begin; cursor < chunk->end;
+	     cursor = next_line(cursor, chunk->end)) {
+		if (counter(&cursor, chunk->end, &nb_items)) {
+			chunk->error = FILE_FORMAT_ERROR;
+			chunk->error_line = chunk->nb_lines;
+			return NULL;
+		}
+		chunk->nb_items += nb_items;
+		chunk->nb_lines++;
+	}
+	return NULL;
+}
+
+Error_enum split_lines(struct chunked_lines *lines, char *begin, char *end,
+		       unsigned int nb_threads, line_counter counter,
+		       size_t *error_line)
+{
+	unsigned int i;
+	size_t size = (size_t)(end - begin);
+	char *boundary;
+	lines->nb_chunks = (unsigned int)MIN((size_t)nb_threads,
+					     size / LINE_CHUNK_MIN_SIZE);
+	lines->nb_chunks = MAX(lines->nb_chunks, 1);
+	lines->chunks =
+	    malloc_wrapper(sizeof(*lines->chunks) * lines->nb_chunks);
+	lines->counter = counter;
+	lines->parser = NULL;
+	lines->argument = NULL;
+	for (i = 0; i < lines->nb_chunks; i++) {
+		lines->chunks[i].lines = lines;
+		lines->chunks[i].begin = i ? lines->chunks[i - 1].end : begin;
+		if (i + 1 == lines->nb_chunks) {
+			lines->chunks[i].end = end;
+			continue;
+		}
+		/* a chunk ends after the newline closing its share of the file */
+		boundary = begin + size / lines->nb_chunks * (i + 1);
+		lines->chunks[i].end = boundary <= lines->chunks[i].begin ?
+		    lines->chunks[i].begin : next_line(boundary - 1, end);
+	}
+	run_chunks(lines, count_chunk);
+	/* a chunk stops counting at its first error, which only shortens the sums after it */
+	lines->nb_lines = 0;
+	lines->nb_items = 0;
+	for (i = 0; i < lines->nb_chunks; i++) {
+		lines->chunks[i].first_line = lines->nb_lines;
+		lines->chunks[i].first_item = lines->nb_items;
+		lines->nb_lines += lines->chunks[i].nb_lines;
+		lines->nb_items += lines->chunks[i].nb_items;
+	}
+	if (first_error(lines, error_line))
+		return FILE_FORMAT_ERROR;
+	return NO_ERROR;
+}
+
+/**
+ * @parse_chunk : parse the lines of a chunk
+ */
+static void *parse_chunk(void *argument)
+{
+	struct line_chunk *chunk = argument;
+	struct chunked_lines *lines = chunk->lines;
+	char *cursor = chunk->begin;
+	size_t i, item = chunk->first_item;
+	chunk->error = NO_ERROR;
+	for (i = 0; i < chunk->nb_lines; i++) {
+		if (lines->parser(&cursor, chunk->end, chunk->first_line + i,
+				  &item, lines->argument)) {
+			chunk->error = FILE_FORMAT_ERROR;
+			chunk->error_line = i;
+			return NULL;
+		}
+		cursor = next_line(cursor, chunk->end);
+	}
+	return NULL;
+}
+
+Error_enum parse_lines(struct chunked_lines *lines, line_parser parser,
+		       void *argument, size_t *error_line)
+{
+	lines->parser = parser;
+	lines->argument = argument;
+	run_chunks(lines, parse_chunk);
+	return first_error(lines, error_line);
+}
+
+void free_chunked_lines(struct chunked_lines *lines)
+{
+	free(lines->chunks);
+	lines->chunks = NULL;
+	lines->nb_chunks = 0;
+}
@@ -0,0 +1,221 @@
+/**
+This module maps the input files in memory and parses their fields in place, a line being a list of fields separated by spaces, tabulations or commas
+**/
+#ifndef __HEADER_MAPPED_FILE
+#define __HEADER_MAPPED_FILE
+
+#include "point.h"
+#include "utils.h"
+
+#include <stddef.h>
+
+/**
+ * @struct mapped_file : a file mapped read-only in memory
+ *
+ * @data : the content of the file, NULL for an empty file
+ * @size : the size of the file in bytes
+ */
+struct mapped_file {
+	char *data;
+	size_t size;
+};
+
+/**
+ * @map_file : map the file @path in memory, exiting on failure as the other wrappers
+ *
+ * @file : the structure to fill
+ * @path : the path of the file to map
+ *
+ * @remark : @file must be unmapped with @unmap_file
+ */
+void map_file(struct mapped_file *file, char *path);
+
+/**
+ * @unmap_file : unmap @file
+ *
+ * @file : the file to unmap
+ */
+void unmap_file(struct mapped_file *file);
+
+/**
+ * @count_lines : count the lines between @begin and @end, the last one not needing a final newline
+ *
+ * @begin : the first character
+ * @end : one past the last character
+ *
+ * @return the number of lines
+ */
+size_t count_lines(char *begin, char *end);
+
+/**
+ * @next_line : gives the beginning of the line after the one of @cursor
+ *
+ * @cursor : a character of the current line
+ * @end : one past the last character
+ *
+ * @return the first character of the next line, @end if there is none
+ */
+char *next_line(char *cursor, char *end);
+
+/**
+ * @skip_field : move @cursor after the next field of the line
+ *
+ * @cursor : the current position, updated
+ * @end : one past the last character
+ *
+ * @return NO_ERROR if there was a field, FILE_FORMAT_ERROR otherwise
+ */
+Error_enum skip_field(char **cursor, char *end);
+
+/**
+ * @check_end_of_line : check that no field is left on the line of @cursor
+ *
+ * @cursor : the current position, moved to the end of the line
+ * @end : one past the last character
+ *
+ * @return NO_ERROR if there is none, FILE_FORMAT_ERROR otherwise
+ */
+Error_enum check_end_of_line(char **cursor, char *end);
+
+/**
+ * @parse_unsigned_field : parse the next field of the line as an unsigned int written in decimal
+ *
+ * @cursor : the current position, moved after the field
+ * @end : one past the last character
+ * @value : the parsed value
+ *
+ * @return NO_ERROR in case of success, FILE_FORMAT_ERROR otherwise
+ */
+Error_enum parse_unsigned_field(char **cursor, char *end,
+				unsigned int *value);
+
+/**
+ * @parse_double_field : parse the next field of the line as a double, giving exactly the value strtod would
+ *
+ * @cursor : the current position, moved after the field
+ * @end : one past the last character
+ * @value : the parsed value
+ *
+ * @return NO_ERROR in case of success, FILE_FORMAT_ERROR otherwise
+ */
+Error_enum parse_double_field(char **cursor, char *end, double *value);
+
+/**
+ * @parse_geo_point_fields : parse the next two fields of the line as the longitude and the latitude of @point
+ *
+ * @cursor : the current position, moved after the fields
+ * @end : one past the last character
+ * @point : the parsed point
+ *
+ * @return NO_ERROR in case of success, FILE_FORMAT_ERROR otherwise
+ */
+Error_enum parse_geo_point_fields(char **cursor, char *end,
+				  Geo_point * point);
+
+/**
+ * Size of file below which a chunk is not worth a thread, in bytes
+ */
+#define LINE_CHUNK_MIN_SIZE (1 << 20)
+
+/**
+ * @line_counter : gives in @nb_items the number of items of the line beginning at @cursor, as the points of a trajectory
+ *
+ * @return NO_ERROR if the line is well formed, FILE_FORMAT_ERROR otherwise
+ */
+typedef Error_enum(*line_counter) (char **cursor, char *end,
+				   size_t *nb_items);
+
+/**
+ * @line_parser : parses the line of index @line beginning at @cursor into the arrays given by @argument, its items beginning at index *@item which is moved past them
+ *
+ * @return NO_ERROR if the line is well formed, FILE_FORMAT_ERROR otherwise
+ */
+typedef Error_enum(*line_parser) (char **cursor, char *end, size_t line,
+				  size_t *item, void *argument);
+
+struct chunked_lines;
+
+/**
+ * @struct line_chunk : a part of the file made of whole lines, handled by one thread
+ *
+ * @lines : the set of chunks it belongs to
+ * @begin : its first character
+ * @end : one past its last character
+ * @first_line : index of its first line
+ * @nb_lines : number of its lines
+ * @first_item : index of its first item
+ * @nb_items : number of its items
+ * @error_line : index in the chunk of the first wrong line
+ * @error : NO_ERROR if all its lines are well formed
+ */
+struct line_chunk {
+	struct chunked_lines *lines;
+	char *begin;
+	char *end;
+	size_t first_line;
+	size_t nb_lines;
+	size_t first_item;
+	size_t nb_items;
+	size_t error_line;
+	Error_enum error;
+};
+
+/**
+ * @struct chunked_lines : lines of a file split in chunks at line boundaries, which are counted then parsed in parallel, one thread per chunk
+ *
+ * @nb_chunks : number of chunks
+ * @chunks : the chunks, in file order
+ * @nb_lines : total number of lines
+ * @nb_items : total number of items, equal to @nb_lines without counter
+ * @counter : the function counting the items of a line, NULL if each line is one item
+ * @parser : the function parsing a line
+ * @argument : the argument given to @parser
+ */
+struct chunked_lines {
+	unsigned int nb_chunks;
+	struct line_chunk *chunks;
+	size_t nb_lines;
+	size_t nb_items;
+	line_counter counter;
+	line_parser parser;
+	void *argument;
+};
+
+/**
+ * @split_lines : split the lines between @begin and @end in at most @nb_threads chunks and count their lines and items
+ *
+ * @lines : the structure to fill
+ * @begin : the first character of the first line
+ * @end : one past the last character
+ * @nb_threads : the maximum number of threads to use
+ * @counter : the function counting the items of a line, NULL if each line is one item
+ * @error_line : the index of the first wrong line in case of error
+ *
+ * @return NO_ERROR in case of success, FILE_FORMAT_ERROR otherwise
+ * @remark : @lines must be freed with @free_chunked_lines, even in case of error
+ */
+Error_enum split_lines(struct chunked_lines *lines, char *begin, char *end,
+		       unsigned int nb_threads, line_counter counter,
+		       size_t *error_line);
+
+/**
+ * @parse_lines : parse all the lines of @lines, each chunk in its own thread, the indices of lines and items following the order of the file
+ *
+ * @lines : the lines counted by @split_lines
+ * @parser : the function parsing a line
+ * @argument : the argument given to @parser, holding the arrays to fill
+ * @error_line : the index of the first wrong line in case of error
+ *
+ * @return NO_ERROR in case of success, FILE_FORMAT_ERROR otherwise
+ */
+Error_enum parse_lines(struct chunked_lines *lines, line_parser parser,
+		       void *argument, size_t *error_line);
+
+/**
+ * @free_chunked_lines : free @lines
+ *
+ * @lines : the structure to free
+ */
+void free_chunked_lines(struct chunked_lines *lines);
+
+#endif
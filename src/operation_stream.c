@@ -0,0 +1,212 @@
+/**
+This module reads an interleaved stream of insertions and deletions of points, so that the fully adversary algorithms can follow a live feed. Every element receives a slot, the index used by the algorithms, and the slots of deleted elements are reused.
+**/
+#define _POSIX_C_SOURCE 200809L
+#include "operation_stream.h"
+#include "mapped_file.h"
+#include "set.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Initial size of the hash table of identifiers, a power of two
+ */
+#define INIT_IDS_SIZE 1024
+
+/**
+ * @hash_id : first entry of the hash table of @stream to look at for @id
+ */
+static unsigned int hash_id(struct operation_stream *stream, unsigned int id)
+{
+	return (id * 2654435761u) & stream->ids_mask;
+}
+
+/**
+ * @find_id : gives the entry of @id in the hash table of @stream, or the empty entry where it would be inserted
+ */
+static struct id_slot *find_id(struct operation_stream *stream,
+			       unsigned int id)
+{
+	unsigned int i = hash_id(stream, id);
+	while (NOT_IN_SET != stream->ids[i].slot && id != stream->ids[i].id)
+		i = (i + 1) & stream->ids_mask;
+	return stream->ids + i;
+}
+
+/**
+ * @allocate_ids : allocate an empty hash table of @size entries
+ */
+static void allocate_ids(struct operation_stream *stream, unsigned int size)
+{
+	stream->ids = malloc_wrapper(sizeof(*stream->ids) * size);
+	memset(stream->ids, -1, sizeof(*stream->ids) * size);
+	stream->ids_mask = size - 1;
+}
+
+/**
+ * @insert_id : map @id to @slot, doubling the hash table when it gets half full
+ */
+static void insert_id(struct operation_stream *stream, unsigned int id,
+		      unsigned int slot)
+{
+	struct id_slot *old = stream->ids, *entry;
+	unsigned int i, size = stream->ids_mask + 1;
+	if (2 * (stream->nb_ids + 1) > size) {
+		allocate_ids(stream, 2 * size);
+		for (i = 0; i < size; i++)
+			if (NOT_IN_SET != old[i].slot)
+				*find_id(stream, old[i].id) = old[i];
+		free(old);
+	}
+	entry = find_id(stream, id);
+	entry->id = id;
+	entry->slot = slot;
+	stream->nb_ids++;
+}
+
+/**
+ * @remove_id : empty @entry, moving back the entries of its cluster so that they can still be found
+ */
+static void remove_id(struct operation_stream *stream, struct id_slot *entry)
+{
+	unsigned int hole = (unsigned int)(entry - stream->ids), i, home;
+	for (i = (hole + 1) & stream->ids_mask;
+	     NOT_IN_SET != stream->ids[i].slot; i = (i + 1) & stream->ids_mask) {
+		home = hash_id(stream, stream->ids[i].id);
+		/* the entry moves unless its home lies cyclically in (hole, i] */
+		if (((i - home) & stream->ids_mask) >=
+		    ((i - hole) & stream->ids_mask)) {
+			stream->ids[hole] = stream->ids[i];
+			hole = i;
+		}
+	}
+	stream->ids[hole].slot = NOT_IN_SET;
+	stream->nb_ids--;
+}
+
+/**
+ * @allocate_slot : gives a free slot, reusing the one of a deleted element if any, and makes @stream->points and @stream->units larger if needed
+ */
+static unsigned int allocate_slot(struct operation_stream *stream)
+{
+	size_t range;
+	if (stream->nb_free)
+		return stream->free_slots[--(stream->nb_free)];
+	if (stream->nb_slots == stream->range) {
+		range = stream->range;
+		stream->points = realloc_wrapper(stream->points, &range,
+						 sizeof(*stream->points));
+		if (NULL != stream->units) {
+			range = stream->range;
+			stream->units = realloc_wrapper(stream->units, &range,
+							sizeof(*stream->units));
+		}
+		free(stream->free_slots);
+		stream->free_slots = malloc_wrapper(sizeof(*stream->free_slots)
+						    * range);
+		stream->range = range;
+	}
+	return (stream->nb_slots)++;
+}
+
+void open_operation_stream(struct operation_stream *stream, char *path)
+{
+	stream->file = 0 == strcmp(path, "-") ? stdin :
+	    fopen_wrapper(path, "r");
+	stream->line = NULL;
+	stream->line_size = 0;
+	stream->line_number = 0;
+	stream->range = OPERATION_STREAM_INIT_RANGE;
+	stream->points = malloc_wrapper(sizeof(*stream->points) *
+					stream->range);
+	stream->units = NULL;
+	if (GREAT_CIRCLE_METRIC == get_metric())
+		stream->units = malloc_wrapper(sizeof(*stream->units) *
+					       stream->range);
+	stream->nb_slots = 0;
+	stream->free_slots = malloc_wrapper(sizeof(*stream->free_slots) *
+					    stream->range);
+	stream->nb_free = 0;
+	allocate_ids(stream, INIT_IDS_SIZE);
+	stream->nb_ids = 0;
+	stream->error = NO_ERROR;
+}
+
+/**
+ * @parse_operation : parse the line of @stream ending at @end into @query
+ *
+ * @return NO_ERROR if the line is a valid operation, FILE_FORMAT_ERROR otherwise
+ */
+static Error_enum parse_operation(struct operation_stream *stream, char *end,
+				  struct query *query)
+{
+	char *cursor = stream->line;
+	struct id_slot *entry;
+	Geo_point point;
+	if (skip_field(&cursor, end) || 1 != cursor - stream->line
+	    || parse_unsigned_field(&cursor, end, &(query->id)))
+		return FILE_FORMAT_ERROR;
+	entry = find_id(stream, query->id);
+	if ('a' == *stream->line) {
+		if (NOT_IN_SET != entry->slot
+		    || parse_geo_point_fields(&cursor, end, &point)
+		    || check_end_of_line(&cursor, end))
+			return FILE_FORMAT_ERROR;
+		query->type = ADD;
+		query->data_index = allocate_slot(stream);
+		stream->points[query->data_index] = point;
+		if (NULL != stream->units)
+			compute_unit_vector(&point,
+					    stream->units + query->data_index);
+		insert_id(stream, query->id, query->data_index);
+		return NO_ERROR;
+	}
+	if ('d' != *stream->line || NOT_IN_SET == entry->slot
+	    || check_end_of_line(&cursor, end))
+		return FILE_FORMAT_ERROR;
+	query->type = REMOVE;
+	query->data_index = entry->slot;
+	/* the coordinates stay valid until the slot is reused by a later line */
+	stream->free_slots[(stream->nb_free)++] = entry->slot;
+	remove_id(stream, entry);
+	return NO_ERROR;
+}
+
+int read_operation(struct operation_stream *stream, struct query *query)
+{
+	ssize_t length;
+	char *cursor;
+	do {
+		length = getline(&(stream->line), &(stream->line_size),
+				 stream->file);
+		if (-1 == length)
+			return 0;
+		stream->line_number++;
+		cursor = stream->line;
+	} while (!check_end_of_line(&cursor, stream->line + length));
+	if (parse_operation(stream, stream->line + length, query)) {
+		fprintf(stderr,
+			"Wrong operation or unknown identifier, incident occured line %lu\n",
+			(unsigned long)stream->line_number);
+		stream->error = FILE_FORMAT_ERROR;
+		return 0;
+	}
+	return 1;
+}
+
+void close_operation_stream(struct operation_stream *stream)
+{
+	if (stdin != stream->file)
+		fclose(stream->file);
+	free(stream->line);
+	stream->line = NULL;
+	free(stream->points);
+	stream->points = NULL;
+	free(stream->units);
+	stream->units = NULL;
+	free(stream->free_slots);
+	stream->free_slots = NULL;
+	free(stream->ids);
+	stream->ids = NULL;
+}
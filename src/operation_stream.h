@@ -0,0 +1,92 @@
+/**
+This module reads an interleaved stream of insertions and deletions of points, so that the fully adversary algorithms can follow a live feed. Every element receives a slot, the index used by the algorithms, and the slots of deleted elements are reused.
+**/
+#ifndef __HEADER_OPERATION_STREAM
+#define __HEADER_OPERATION_STREAM
+
+#include "point.h"
+#include "utils.h"
+#include "query.h"
+
+#include <stdio.h>
+
+/**
+ * Initial number of slots of a stream
+ */
+#define OPERATION_STREAM_INIT_RANGE 1024
+
+/**
+ * @struct id_slot : entry of the hash table giving the slot of each identifier
+ *
+ * @id : the identifier of the element in the stream
+ * @slot : its slot, NOT_IN_SET for an empty entry
+ */
+struct id_slot {
+	unsigned int id;
+	unsigned int slot;
+};
+
+/**
+ * @struct operation_stream : reader of a stream of lines "a id longitude latitude", inserting the element id, and "d id", deleting it
+ *
+ * @file : the file read
+ * @line : the last line read
+ * @line_size : size of the buffer of @line
+ * @line_number : number of lines read
+ * @points : coordinates of the element of each slot
+ * @units : unit vector of the element of each slot, NULL unless the great-circle metric is used
+ * @range : number of slots allocated, growing geometrically
+ * @nb_slots : number of slots ever used
+ * @free_slots : slots of the deleted elements, reused first
+ * @nb_free : number of slots in @free_slots
+ * @ids : open addressing hash table of the identifiers of the live elements
+ * @ids_mask : size of @ids minus one, a power of two
+ * @nb_ids : number of live elements
+ * @error : NO_ERROR unless a wrong line was found
+ */
+struct operation_stream {
+	FILE *file;
+	char *line;
+	size_t line_size;
+	size_t line_number;
+	Geo_point *points;
+	Unit_vector *units;
+	size_t range;
+	unsigned int nb_slots;
+	unsigned int *free_slots;
+	unsigned int nb_free;
+	struct id_slot *ids;
+	unsigned int ids_mask;
+	unsigned int nb_ids;
+	Error_enum error;
+};
+
+/**
+ * @open_operation_stream : open the stream of operations @path
+ *
+ * @stream : the stream to initialise
+ * @path : the path of the stream, - for the standard input
+ *
+ * @remark : @stream must be closed with @close_operation_stream
+ */
+void open_operation_stream(struct operation_stream *stream, char *path);
+
+/**
+ * @read_operation : read the next operation of @stream, waiting for it on a pipe
+ *
+ * @stream : the stream
+ * @query : the query of the operation, whose data_index is the slot of the element and id its identifier
+ *
+ * @return 1 if an operation was read, 0 at the end of the stream or on a wrong line, which sets @stream->error
+ * @remark : @stream->points and @stream->range can change, the slot of a deleted element being reused by a later insertion
+ */
+int read_operation(struct operation_stream *stream, struct query *query);
+
+/**
+ * @close_operation_stream : close @stream
+ *
+ * @stream : the stream to close
+ */
+void close_operation_stream(struct operation_stream *stream);
+
+#endif
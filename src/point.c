@@ -9,19 +9,31 @@ This module contains some fonction related to GPS points
 #include <math.h>
 #include <string.h>
 
+static Metric_type metric = EUCLIDEAN_METRIC;
+
 double euclidean_distance(Geo_point * a, Geo_point * b)
 {
-	return sqrt(SQUARE(a->latitude - b->latitude) +
-		    SQUARE(MIN
-			   (ABS(a->longitude - b->longitude),
-			    360 - ABS(a->longitude - b->longitude))));
+	double longitude = ABS((double)a->longitude - b->longitude);
+	return sqrt(SQUARE((double)a->latitude - b->latitude) +
+		    SQUARE(MIN(longitude, 360 - longitude)));
 }
 
+/**
+ * The central angle is computed from the chord between the points on the unit sphere, which unlike the spherical law of cosines stays accurate for close points and needs no trigonometry but one asin.
+ */
 double great_circle_distance(Geo_point * a, Geo_point * b)
 {
-	return acos(sin(a->latitude) * sin(b->latitude) +
-		    cos(a->latitude) * cos(b->latitude) * cos(a->longitude -
-							      b->longitude));
+	Unit_vector u, v;
+	compute_unit_vector(a, &u);
+	compute_unit_vector(b, &v);
+	return unit_vector_distance(&u, &v);
+}
+
+double unit_vector_distance(Unit_vector * a, Unit_vector * b)
+{
+	double chord = sqrt(SQUARE(a->x - b->x) + SQUARE(a->y - b->y) +
+			    SQUARE(a->z - b->z));
+	return 2 * EARTH_RADIUS * asin(MIN(chord / 2, 1));
 }
 
 #ifndef M_PI
@@ -30,6 +42,70 @@ double great_circle_distance(Geo_point * a, Geo_point * b)
 
 void translate_coordinates_radian(Geo_point * point)
 {
-	point->latitude = point->latitude * M_PI / 180;
-	point->longitude = point->longitude * M_PI / 180;
+	point->latitude = (Coordinate) (point->latitude * M_PI / 180);
+	point->longitude = (Coordinate) (point->longitude * M_PI / 180);
+}
+
+
+void set_metric(Metric_type new_metric)
+{
+	metric = new_metric;
+}
+
+Metric_type get_metric(void)
+{
+	return metric;
+}
+
+void compute_unit_vector(Geo_point * point, Unit_vector * vector)
+{
+	double latitude = point->latitude * M_PI / 180;
+	double longitude = point->longitude * M_PI / 180;
+	vector->x = cos(latitude) * cos(longitude);
+	vector->y = cos(latitude) * sin(longitude);
+	vector->z = sin(latitude);
+}
+
+Unit_vector *unit_vector_array(Geo_point * points, unsigned int nb)
+{
+	unsigned int i;
+	Unit_vector *vectors;
+	if (GREAT_CIRCLE_METRIC != metric)
+		return NULL;
+	vectors = malloc_wrapper(sizeof(*vectors) * MAX(nb, 1));
+	for (i = 0; i < nb; i++)
+		compute_unit_vector(points + i, vectors + i);
+	return vectors;
+}
+
+double geo_distance(Geo_point * a, Geo_point * b)
+{
+	if (GREAT_CIRCLE_METRIC == metric)
+		return great_circle_distance(a, b);
+	return euclidean_distance(a, b);
+}
+
+double geo_distance_unit(Geo_point * a, Unit_vector * a_unit, Geo_point * b,
+			 Unit_vector * b_unit)
+{
+	Unit_vector u, v;
+	if (GREAT_CIRCLE_METRIC != metric)
+		return euclidean_distance(a, b);
+	if (NULL == a_unit) {
+		compute_unit_vector(a, &u);
+		a_unit = &u;
+	}
+	if (NULL == b_unit) {
+		compute_unit_vector(b, &v);
+		b_unit = &v;
+	}
+	return unit_vector_distance(a_unit, b_unit);
+}
+
+double squared_chord(double radius)
+{
+	double angle = radius / EARTH_RADIUS;
+	if (angle >= M_PI)
+		return 4;
+	return SQUARE(2 * sin(angle / 2));
 }
@@ -4,20 +4,124 @@ This module contains some fonction related to GPS points
 #ifndef __HEADER_DATA
 #define __HEADER_DATA
 
+/* type of stored coordinates, computations on them being done in double */
+#ifdef FLOAT_COORDINATES
+typedef float Coordinate;
+#else
+typedef double Coordinate;
+#endif
+
 typedef struct {
-	double latitude;
-	double longitude;
+	Coordinate latitude;
+	Coordinate longitude;
 } Geo_point;
 
+/* position of a point on the unit sphere, kept apart from the points for the great-circle metric */
+typedef struct {
+	double x;
+	double y;
+	double z;
+} Unit_vector;
+
+/* the unit vector of index @index of @vectors, NULL if @vectors is */
+#define UNIT_VECTOR_AT(vectors, index) (NULL == (vectors) ? NULL : (vectors) + (index))
+
 typedef struct {
 	Geo_point point;
 	unsigned int in_date;
 	unsigned int exp_date;
 } Timestamped_point;
 
+typedef enum {
+	EUCLIDEAN_METRIC,	/* planar distance in degrees */
+	GREAT_CIRCLE_METRIC,	/* great-circle distance in metres */
+	LAST_METRIC_TYPE
+} Metric_type;
+
+/* mean radius of the Earth in metres */
+#define EARTH_RADIUS 6371008.8
+
+/* great-circle length of one degree of latitude */
+#define METRES_PER_DEGREE (EARTH_RADIUS * 3.14159265358979323846 / 180)
+
 double euclidean_distance(Geo_point * a, Geo_point * b);
 
 double great_circle_distance(Geo_point * a, Geo_point * b);
 
+/**
+ * @unit_vector_distance : great-circle distance between two points given by their unit vectors
+ *
+ * @a : the unit vector of the first point
+ * @b : the unit vector of the second point
+ *
+ * @return the distance in metres, exactly great_circle_distance of the two points
+ */
+double unit_vector_distance(Unit_vector * a, Unit_vector * b);
+
 void translate_coordinates_radian(Geo_point * point);
+
+/**
+ * @set_metric : choose the distance used by @geo_distance, has to be called before any point is imported
+ *
+ * @metric : the metric to use
+ */
+void set_metric(Metric_type metric);
+
+/**
+ * @get_metric : gives the distance used by @geo_distance
+ *
+ * @return the metric in use
+ */
+Metric_type get_metric(void);
+
+/**
+ * @compute_unit_vector : gives the position of @point on the unit sphere
+ *
+ * @point : the point, in degrees
+ * @vector : where its unit vector is stored
+ */
+void compute_unit_vector(Geo_point * point, Unit_vector * vector);
+
+/**
+ * @unit_vector_array : gives the unit vectors of the @nb points of @points, if the metric in use needs them
+ *
+ * @points : the points
+ * @nb : the number of points
+ *
+ * @return an array of @nb unit vectors to free, NULL with the euclidean metric
+ * @remark : the points only hold their latitude and longitude, the owner of an array of points keeps this array beside it so that the great-circle metric does no trigonometry on every distance
+ */
+Unit_vector *unit_vector_array(Geo_point * points, unsigned int nb);
+
+/**
+ * @geo_distance : computes the distance between @a and @b with the metric in use
+ *
+ * @a : the first point
+ * @b : the second point
+ *
+ * @return euclidean_distance(@a, @b) or great_circle_distance(@a, @b)
+ */
+double geo_distance(Geo_point * a, Geo_point * b);
+
+/**
+ * @geo_distance_unit : computes geo_distance(@a, @b), from the unit vectors of the points if they are given
+ *
+ * @a : the first point
+ * @a_unit : its unit vector, NULL to compute it if needed
+ * @b : the second point
+ * @b_unit : its unit vector, NULL to compute it if needed
+ *
+ * @return the distance, exactly geo_distance(@a, @b)
+ */
+double geo_distance_unit(Geo_point * a, Unit_vector * a_unit, Geo_point * b,
+			 Unit_vector * b_unit);
+
+/**
+ * @squared_chord : gives the squared chord between two points of the unit sphere whose great-circle distance is @radius
+ *
+ * @radius : the distance in metres
+ *
+ * @return the squared chord, the great-circle distance growing with the chord
+ */
+double squared_chord(double radius);
 #endif
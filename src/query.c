@@ -4,6 +4,7 @@ Module for query handling
 #include "utils.h"
 #include "query.h"
 #include "set.h"
+#include "mapped_file.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -12,70 +13,468 @@ Module for query handling
 #include <unistd.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
 
-void initialise_query_provider(struct query_provider * queries, char *path)
+/**
+ * @read_fully : read @size bytes of @fd in @buffer, unless the file ends first
+ *
+ * @return the number of bytes read
+ */
+static size_t read_fully(int fd, void *buffer, size_t size)
 {
-	queries->fd = open_wrapper(path, O_RDONLY | O_CREAT);
-	queries->current = queries->nb_query = 0;
+	char *bytes = buffer;
+	size_t filled = 0;
+	ssize_t tmp;
+	/* a pipe gives less than asked, read until the buffer is full */
+	while (filled < size
+	       && 0 < (tmp = read_wrapper(fd, bytes + filled, size - filled, 1)))
+		filled += (size_t)tmp;
+	return filled;
+}
+
+/**
+ * @check_batch : check that the @size records of @batch are within the range of the header of @queries
+ *
+ * @return NO_ERROR if they are, FILE_FORMAT_ERROR otherwise
+ */
+static Error_enum check_batch(struct query_provider * queries,
+			      unsigned int *batch, size_t size)
+{
+	size_t i;
+	for (i = 0; i < size; i++)
+		if ((batch[i] & QUERY_INDEX_MASK) >= queries->range)
+			return FILE_FORMAT_ERROR;
+	return NO_ERROR;
+}
+
+/**
+ * @read_chunks : uncompress in @batch the next chunks of @queries, as many as fit
+ *
+ * @return the number of records read, or (size_t) -1 if a chunk is truncated or corrupted
+ */
+static size_t read_chunks(struct query_provider * queries, unsigned int *batch)
+{
+	uint32_t sizes[2];	/* number of records and of bytes of the chunk */
+	size_t size = 0;
+	while (size + QUERY_CHUNK_SIZE <= QUERY_BATCH_SIZE
+	       && (uint64_t) size < queries->header.nb_queries) {
+		if (sizeof(sizes) != read_fully(queries->fd, sizes, sizeof(sizes))
+		    || 0 == sizes[0] || QUERY_CHUNK_SIZE < sizes[0]
+		    || (uint64_t) sizes[0] > queries->header.nb_queries - size
+		    || QUERY_CHUNK_BYTES(sizes[0]) < sizes[1]
+		    || sizes[1] != read_fully(queries->fd, queries->chunk,
+					      sizes[1])
+		    || decode_query_chunk(&(queries->codec), queries->chunk,
+					  sizes[1], sizes[0], batch + size))
+			return (size_t) - 1;
+		size += sizes[0];
+	}
+	return size;
+}
+
+/**
+ * @fill_batch : read the next records of @queries in @batch, checking them against the header if any
+ *
+ * @return the number of records read, 0 at the end of the file or on error, which sets @queries->error
+ */
+static size_t fill_batch(struct query_provider * queries, unsigned int *batch)
+{
+	size_t size = QUERY_BATCH_SIZE;
+	if (NULL != queries->chunk) {
+		size = read_chunks(queries, batch);
+		if ((size_t) - 1 == size) {
+			fprintf(stderr, "%s is truncated or corrupted\n",
+				queries->path);
+			queries->error = FILE_FORMAT_ERROR;
+			return 0;
+		}
+	} else {
+		if (queries->has_opcodes)
+			size = (size_t)MIN(queries->header.nb_queries,
+					   (uint64_t) size);
+		size = (queries->prefix + read_fully(queries->fd,
+						     (char *)batch +
+						     queries->prefix,
+						     sizeof(*batch) * size -
+						     queries->prefix)) /
+		    sizeof(*batch);
+		queries->prefix = 0;
+		if (!queries->has_opcodes)
+			return size;
+		if ((uint64_t) size < MIN(queries->header.nb_queries,
+					  (uint64_t) QUERY_BATCH_SIZE)) {
+			fprintf(stderr, "%s is truncated\n", queries->path);
+			queries->error = FILE_FORMAT_ERROR;
+			return 0;
+		}
+	}
+	if (check_batch(queries, batch, size)) {
+		fprintf(stderr, "%s has an index out of its range\n",
+			queries->path);
+		queries->error = FILE_FORMAT_ERROR;
+		return 0;
+	}
+	queries->header.nb_queries -= size;
+	return size;
+}
+
+/**
+ * @read_queries : body of the reader thread, filling the batches of the provider @argument in turn until the end of the file
+ */
+static void *read_queries(void *argument)
+{
+	struct query_provider *queries = argument;
+	size_t size;
+	do {
+		pthread_mutex_lock(&(queries->mutex));
+		while (QUERY_NB_BATCHES == queries->nb_filled && !queries->stop)
+			pthread_cond_wait(&(queries->emptied),
+					  &(queries->mutex));
+		if (queries->stop) {
+			pthread_mutex_unlock(&(queries->mutex));
+			return NULL;
+		}
+		pthread_mutex_unlock(&(queries->mutex));
+		size = fill_batch(queries,
+				  queries->batches[queries->write_index]);
+		pthread_mutex_lock(&(queries->mutex));
+		queries->sizes[queries->write_index] = size;
+		queries->nb_filled++;
+		pthread_cond_signal(&(queries->filled));
+		pthread_mutex_unlock(&(queries->mutex));
+		queries->write_index =
+		    (queries->write_index + 1) % QUERY_NB_BATCHES;
+	} while (size);
+	return NULL;
 }
 
+/**
+ * @read_header : look for a header at the beginning of the file of @queries, keeping the bytes read in the first batch if there is none
+ *
+ * @return NO_ERROR if there is no header or a valid one, FILE_FORMAT_ERROR otherwise
+ */
+static Error_enum read_header(struct query_provider * queries)
+{
+	struct query_header *header = &(queries->header);
+	queries->prefix = read_fully(queries->fd, queries->batches[0],
+				     sizeof(header->magic));
+	queries->has_opcodes = 0;
+	queries->range = 0;
+	queries->chunk = NULL;
+	queries->present = NULL;
+	if (sizeof(header->magic) != queries->prefix
+	    || memcmp(queries->batches[0], QUERY_MAGIC, sizeof(QUERY_MAGIC)))
+		return NO_ERROR;
+	queries->prefix = 0;
+	queries->has_opcodes = 1;
+	memcpy(header->magic, QUERY_MAGIC, sizeof(QUERY_MAGIC));
+	if (sizeof(*header) - sizeof(header->magic) !=
+	    read_fully(queries->fd, (char *)header + sizeof(header->magic),
+		       sizeof(*header) - sizeof(header->magic))
+	    || 0 == header->version || QUERY_VERSION < header->version
+	    || (1 == header->version && QUERY_ENCODING_RAW != header->encoding)
+	    || LAST_QUERY_ENCODING <= header->encoding
+	    || QUERY_BYTE_ORDER != header->byte_order
+	    || sizeof(uint32_t) != header->record_size
+	    || header->range > (uint64_t) QUERY_INDEX_MASK + 1
+	    || header->nb_insertions > header->nb_queries) {
+		fprintf(stderr,
+			"%s has an invalid header or was written by another version or on another architecture\n",
+			queries->path);
+		return FILE_FORMAT_ERROR;
+	}
+	queries->range = (unsigned int)header->range;
+	queries->present = calloc_wrapper(MAX((queries->range + 7) / 8, 1), 1);
+	if (QUERY_ENCODING_STREAMVBYTE == header->encoding) {
+		initialise_query_codec(&(queries->codec));
+		queries->chunk =
+		    malloc_wrapper(QUERY_CHUNK_BYTES(QUERY_CHUNK_SIZE) +
+				   QUERY_CHUNK_PADDING);
+	}
+	return NO_ERROR;
+}
+
+Error_enum initialise_query_provider(struct query_provider * queries,
+				     char *path)
+{
+	unsigned int i;
+	queries->path = path;
+	queries->fd = open_wrapper(path, O_RDONLY);
+	queries->current = queries->nb_query = 0;
+	for (i = 0; i < QUERY_NB_BATCHES; i++)
+		queries->batches[i] =
+		    malloc_wrapper(sizeof(**queries->batches) *
+				   QUERY_BATCH_SIZE);
+	queries->error = read_header(queries);
+	if (queries->error) {
+		for (i = 0; i < QUERY_NB_BATCHES; i++)
+			free(queries->batches[i]);
+		close(queries->fd);
+		return queries->error;
+	}
+	queries->write_index = queries->read_index = queries->nb_filled = 0;
+	queries->stop = queries->end = 0;
+	queries->buffer = NULL;
+	pthread_mutex_init(&(queries->mutex), NULL);
+	pthread_cond_init(&(queries->filled), NULL);
+	pthread_cond_init(&(queries->emptied), NULL);
+	if (pthread_create(&(queries->reader), NULL, read_queries, queries)) {
+		perror("pthread_create");
+		exit(EXIT_FAILURE);
+	}
+	return NO_ERROR;
+}
 
 void free_query_provider(struct query_provider * queries)
 {
+	unsigned int i;
+	pthread_mutex_lock(&(queries->mutex));
+	queries->stop = 1;
+	pthread_cond_signal(&(queries->emptied));
+	pthread_mutex_unlock(&(queries->mutex));
+	pthread_join(queries->reader, NULL);
+	pthread_mutex_destroy(&(queries->mutex));
+	pthread_cond_destroy(&(queries->filled));
+	pthread_cond_destroy(&(queries->emptied));
+	for (i = 0; i < QUERY_NB_BATCHES; i++)
+		free(queries->batches[i]);
+	free(queries->chunk);
+	free(queries->present);
 	close(queries->fd);
 }
 
-int
-get_next_query_set(struct query_provider * queries, struct query * next_query,
-		   struct set_collection * sets)
+/**
+ * @next_index : gives in @index the next index of @queries, handing the consumed batch back to the reader thread when it is exhausted
+ *
+ * @return 1 if an index was read, 0 at the end of the file
+ */
+static int next_index(struct query_provider * queries, unsigned int *index)
 {
 	if (queries->current >= queries->nb_query) {
-		queries->current = 0;
+		if (queries->end)
+			return 0;
+		pthread_mutex_lock(&(queries->mutex));
+		if (NULL != queries->buffer) {
+			queries->nb_filled--;
+			queries->read_index =
+			    (queries->read_index + 1) % QUERY_NB_BATCHES;
+			pthread_cond_signal(&(queries->emptied));
+		}
+		while (0 == queries->nb_filled)
+			pthread_cond_wait(&(queries->filled),
+					  &(queries->mutex));
+		queries->buffer = queries->batches[queries->read_index];
 		queries->nb_query =
-		    read_wrapper(queries->fd, queries->buffer, BUFSIZ,
-				 sizeof(next_query->data_index));
-		if (!queries->nb_query)
+		    (ssize_t) queries->sizes[queries->read_index];
+		pthread_mutex_unlock(&(queries->mutex));
+		queries->current = 0;
+		if (!queries->nb_query) {
+			queries->end = 1;
 			return 0;
+		}
 	}
-	next_query->data_index = queries->buffer[queries->current];
-	next_query->type =
-	    (has_element_set_collection(sets, next_query->data_index) ? REMOVE :
-	     ADD);
+	*index = queries->buffer[queries->current];
 	queries->current++;
 	return 1;
 }
 
+/**
+ * @decode_next_query : gives the next query of @queries, of type LAST_QUERY_TYPE if the file does not give it
+ *
+ * @return 1 if a query was read, 0 at the end of the file
+ */
+static int decode_next_query(struct query_provider * queries,
+			     struct query * next_query)
+{
+	unsigned int record;
+	if (!next_index(queries, &record))
+		return 0;
+	if (queries->has_opcodes) {
+		next_query->type = record & QUERY_REMOVE_FLAG ? REMOVE : ADD;
+		next_query->data_index = record & QUERY_INDEX_MASK;
+	} else {
+		next_query->type = LAST_QUERY_TYPE;
+		next_query->data_index = record;
+	}
+	next_query->id = next_query->data_index;
+	return 1;
+}
+
+/**
+ * @check_presence : check that @query adds an element absent or removes an element present, according to the previous queries of @queries, and record its effect
+ *
+ * @return 1 if it does or if the file does not give the type of the queries, 0 otherwise, which sets @queries->error
+ */
+static int check_presence(struct query_provider * queries,
+			  struct query * query)
+{
+	unsigned char *byte;
+	unsigned char bit;
+	if (!queries->has_opcodes)
+		return 1;
+	byte = queries->present + query->data_index / 8;
+	bit = (unsigned char)(1u << (query->data_index % 8));
+	if ((ADD == query->type) == !!(*byte & bit)) {
+		fprintf(stderr, "%s %s the element %u, which is %s\n",
+			queries->path,
+			ADD == query->type ? "adds" : "removes",
+			query->data_index,
+			ADD == query->type ? "already present" : "absent");
+		queries->error = FILE_FORMAT_ERROR;
+		return 0;
+	}
+	*byte ^= bit;
+	return 1;
+}
+
+int
+get_next_query_set(struct query_provider * queries, struct query * next_query,
+		   struct set_collection * sets)
+{
+	if (!decode_next_query(queries, next_query)
+	    || !check_presence(queries, next_query))
+		return 0;
+	if (LAST_QUERY_TYPE == next_query->type)
+		next_query->type =
+		    (has_element_set_collection(sets, next_query->data_index) ?
+		     REMOVE : ADD);
+	return 1;
+}
+
 int get_next_query_lookup(struct query_provider * queries, struct query * next_query,
 			  struct lookup_table * lookup)
 {
-	if (queries->current >= queries->nb_query) {
-		queries->current = 0;
-		queries->nb_query =
-		    read_wrapper(queries->fd, queries->buffer, BUFSIZ,
-				 sizeof(next_query->data_index));
-		if (!queries->nb_query)
-			return 0;
-	}
-	next_query->data_index = queries->buffer[queries->current];
-	next_query->type =
-	    (has_element_lookup(lookup, next_query->data_index) ? REMOVE : ADD);
-	queries->current++;
+	if (!decode_next_query(queries, next_query)
+	    || !check_presence(queries, next_query))
+		return 0;
+	if (LAST_QUERY_TYPE == next_query->type)
+		next_query->type =
+		    (has_element_lookup(lookup, next_query->data_index) ?
+		     REMOVE : ADD);
 	return 1;
 }
 
 int get_next_query_trajectories(struct query_provider * queries, struct query * next_query)
 {
-	if (queries->current >= queries->nb_query) {
-		queries->current = 0;
-		queries->nb_query =
-		    read_wrapper(queries->fd, queries->buffer, BUFSIZ,
-				 sizeof(next_query->data_index));
-		if (!queries->nb_query)
-			return 0;
+	if (!decode_next_query(queries, next_query))
+		return 0;
+	if (REMOVE == next_query->type) {
+		fprintf(stderr,
+			"%s removes an element, trajectories can only be added\n",
+			queries->path);
+		queries->error = FILE_FORMAT_ERROR;
+		return 0;
 	}
-	next_query->data_index = queries->buffer[queries->current];
 	next_query->type = ADD;
-	queries->current++;
 	return 1;
 }
 
+void open_query_writer(struct query_writer *writer, char *path,
+		       Query_encoding encoding)
+{
+	struct query_header *header = &(writer->header);
+	writer->path = path;
+	writer->file = fopen_wrapper(path, "wb");
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, QUERY_MAGIC, sizeof(QUERY_MAGIC));
+	header->version = QUERY_VERSION;
+	header->byte_order = QUERY_BYTE_ORDER;
+	header->record_size = sizeof(uint32_t);
+	header->encoding = encoding;
+	/* written again once the numbers of queries are known */
+	fwrite(header, sizeof(*header), 1, writer->file);
+	initialise_query_codec(&(writer->codec));
+	writer->nb_records = 0;
+	writer->chunk = QUERY_ENCODING_STREAMVBYTE == encoding ?
+	    malloc_wrapper(QUERY_CHUNK_BYTES(QUERY_CHUNK_SIZE)) : NULL;
+}
+
+/**
+ * @flush_query_writer : write the records buffered by @writer, as one chunk if it compresses them
+ */
+static void flush_query_writer(struct query_writer *writer)
+{
+	uint32_t sizes[2];
+	if (0 == writer->nb_records)
+		return;
+	if (NULL == writer->chunk) {
+		fwrite(writer->records, sizeof(*writer->records),
+		       writer->nb_records, writer->file);
+	} else {
+		sizes[0] = (uint32_t) writer->nb_records;
+		sizes[1] = (uint32_t) encode_query_chunk(&(writer->codec),
+							 writer->records,
+							 writer->nb_records,
+							 writer->chunk);
+		fwrite(sizes, sizeof(sizes), 1, writer->file);
+		fwrite(writer->chunk, 1, sizes[1], writer->file);
+	}
+	writer->nb_records = 0;
+}
+
+void write_query(struct query_writer *writer, Query_type type,
+		 unsigned int index)
+{
+	assert(index <= QUERY_INDEX_MASK && (ADD == type || REMOVE == type));
+	writer->records[writer->nb_records] =
+	    index | (REMOVE == type ? QUERY_REMOVE_FLAG : 0);
+	writer->header.nb_queries++;
+	if (ADD == type)
+		writer->header.nb_insertions++;
+	writer->header.range = MAX(writer->header.range, (uint64_t) index + 1);
+	if (QUERY_CHUNK_SIZE == ++(writer->nb_records))
+		flush_query_writer(writer);
+}
+
+Error_enum close_query_writer(struct query_writer *writer)
+{
+	int error;
+	flush_query_writer(writer);
+	rewind(writer->file);
+	fwrite(&(writer->header), sizeof(writer->header), 1, writer->file);
+	free(writer->chunk);
+	writer->chunk = NULL;
+	error = ferror(writer->file);
+	if (fclose(writer->file) || error) {
+		fprintf(stderr, "An error occured while writing %s\n",
+			writer->path);
+		return IO_ERROR;
+	}
+	return NO_ERROR;
+}
+
+Error_enum convert_legacy_queries(char *legacy_path, char *path, int parity,
+				  Query_encoding encoding)
+{
+	struct mapped_file file;
+	struct query_writer writer;
+	unsigned int *indices, range = 0;
+	char *present = NULL;
+	Query_type type = ADD;
+	size_t i, nb;
+	map_file(&file, legacy_path);
+	indices = (unsigned int *)file.data;
+	nb = file.size / sizeof(*indices);
+	for (i = 0; i < nb; i++) {
+		if (indices[i] > QUERY_INDEX_MASK) {
+			fprintf(stderr, "%s has an index too large: %u\n",
+				legacy_path, indices[i]);
+			unmap_file(&file);
+			return FILE_FORMAT_ERROR;
+		}
+		range = MAX(range, indices[i] + 1);
+	}
+	if (parity)
+		present = calloc_wrapper(MAX(range, 1), 1);
+	open_query_writer(&writer, path, encoding);
+	for (i = 0; i < nb; i++) {
+		if (parity) {
+			type = present[indices[i]] ? REMOVE : ADD;
+			present[indices[i]] = (char)!present[indices[i]];
+		}
+		write_query(&writer, type, indices[i]);
+	}
+	free(present);
+	unmap_file(&file);
+	return close_query_writer(&writer);
+}
@@ -6,9 +6,14 @@ Module for query handling
 #define __HEADER_QUERY_STRUCTURE__
 
 #include <stdio.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <stdint.h>
 
 #include "set.h"
 #include "lookup.h"
+#include "utils.h"
+#include "query_codec.h"
 
 /**
  * @Query_type : types of query
@@ -22,25 +27,133 @@ typedef enum {
  *
  * @type : type of query
  * @data_index : index of the element related to the query
+ * @id : identifier of the element in the logs, @data_index unless the element comes from an operation stream
  */
 struct query{
 	Query_type type;
 	unsigned int data_index;
+	unsigned int id;
 };
 
 /**
- * @struct query_provider : A provider of queries
+ * Magic string beginning every query file with a header, files without it being read in the legacy format: raw indices whose parity gives the type of the query
+ */
+#define QUERY_MAGIC "KCQUERY"
+
+/**
+ * Version of the format, increased on every incompatible change
+ */
+#define QUERY_VERSION 2
+
+/**
+ * Value stored in the header to detect files written with another byte order
+ */
+#define QUERY_BYTE_ORDER 0x01020304
+
+/**
+ * Bit of a record set for a REMOVE query, the other bits giving the index of the element
+ */
+#define QUERY_REMOVE_FLAG 0x80000000u
+
+/**
+ * Largest index a record can hold
+ */
+#define QUERY_INDEX_MASK 0x7fffffffu
+
+/**
+ * @Query_encoding : encodings of the records of a query file
+ *
+ * QUERY_ENCODING_RAW : the records follow the header
+ * QUERY_ENCODING_STREAMVBYTE : the records are compressed by chunks of QUERY_CHUNK_SIZE, each one preceded by its number of records and its size in bytes, as two uint32_t
+ */
+typedef enum {
+	QUERY_ENCODING_RAW, QUERY_ENCODING_STREAMVBYTE, LAST_QUERY_ENCODING
+} Query_encoding;
+
+/**
+ * @struct query_header : header of a query file, followed by @nb_queries records of @record_size bytes, all in the byte order of the machine
+ *
+ * @magic : QUERY_MAGIC padded with zeros
+ * @version : QUERY_VERSION, version 1 being read as well since it only has raw records
+ * @byte_order : QUERY_BYTE_ORDER
+ * @record_size : size of a record, sizeof(uint32_t)
+ * @encoding : the Query_encoding of the records, zero in version 1
+ * @nb_queries : number of records
+ * @nb_insertions : number of ADD records, the others being REMOVE records
+ * @range : one more than the largest index of the records
+ */
+struct query_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t record_size;
+	uint32_t encoding;
+	uint64_t nb_queries;
+	uint64_t nb_insertions;
+	uint64_t range;
+};
+
+/**
+ * Number of indices read at once by the reader thread of a query provider
+ */
+#define QUERY_BATCH_SIZE (1 << 20)
+
+/**
+ * Number of batches of a query provider, filled by its reader thread while the previous ones are consumed
+ */
+#define QUERY_NB_BATCHES 2
+
+/**
+ * @struct query_provider : A provider of queries, whose file is read by a thread in batches handed over through a ring
  *
  * @path : path of the query file
  * @fd : file descriptor to the file
- * @buffer : file buffer
+ * @has_opcodes : 1 if the file has a header and its records their type, 0 for the legacy format
+ * @header : the header of the file if @has_opcodes is set
+ * @prefix : number of bytes of the first batch read while looking for the header
+ * @range : one more than the largest index of the file, 0 if unknown
+ * @codec : state of the decompression of a compressed file
+ * @chunk : buffer of the compressed chunk being read, NULL unless the file is compressed
+ * @present : bitmap of the indices added and not removed yet by the queries read, NULL unless @has_opcodes is set
+ * @error : NO_ERROR unless the file is inconsistent with its header
+ * @reader : the thread reading the file
+ * @mutex : protects @sizes, @nb_filled and @stop
+ * @filled : signaled by @reader when a batch is filled
+ * @emptied : signaled when a batch is consumed
+ * @batches : the ring of batches
+ * @sizes : number of indices of each filled batch, 0 for the end of the file
+ * @write_index : next batch filled by @reader
+ * @read_index : batch being consumed
+ * @nb_filled : number of batches filled and not consumed yet, the one in @buffer included
+ * @stop : asks @reader to stop
+ * @end : set once the end of the file is reached
+ * @buffer : batch being consumed, NULL before the first one
  * @current : next query to read
  * @nb_query : total number of query in buffer
  */
 struct query_provider{
 	char *path;
 	int fd;
-	unsigned int buffer[BUFSIZ];
+	int has_opcodes;
+	struct query_header header;
+	size_t prefix;
+	unsigned int range;
+	struct query_codec codec;
+	unsigned char *chunk;
+	unsigned char *present;
+	Error_enum error;
+	pthread_t reader;
+	pthread_mutex_t mutex;
+	pthread_cond_t filled;
+	pthread_cond_t emptied;
+	unsigned int *batches[QUERY_NB_BATCHES];
+	size_t sizes[QUERY_NB_BATCHES];
+	unsigned int write_index;
+	unsigned int read_index;
+	unsigned int nb_filled;
+	int stop;
+	int end;
+	unsigned int *buffer;
 	ssize_t current;
 	ssize_t nb_query;
 };
@@ -50,8 +163,12 @@ struct query_provider{
  *
  * @queries : the query provider to initialise
  * @path : the path of the file containing the queries
+ *
+ * @return NO_ERROR if no error happens, FILE_FORMAT_ERROR if the header is invalid
+ * @remark : @queries starts a thread reading the file, stopped by @free_query_provider
  */
-void initialise_query_provider(struct query_provider * queries, char *path);
+Error_enum initialise_query_provider(struct query_provider * queries,
+				     char *path);
 
 /**
  * @free_query_provider : free @queries
@@ -68,6 +185,7 @@ void free_query_provider(struct query_provider * queries);
  * @sets : a set collection used for context
  *
  * @return 1 if sucessfull, 0 otherwise.
+ * @remark : a query adding an element already present or removing an element absent sets @queries->error to FILE_FORMAT_ERROR and ends the queries
  */
 int get_next_query_set(struct query_provider * queries, struct query * next_query,
 		       struct set_collection * sets);
@@ -79,6 +197,7 @@ int get_next_query_set(struct query_provider * queries, struct query * next_quer
  * @lookup : a lookup table used for context
  *
  * @return 1 if sucessfull, 0 otherwise.
+ * @remark : a query adding an element already present or removing an element absent sets @queries->error to FILE_FORMAT_ERROR and ends the queries
  */
 int get_next_query_lookup(struct query_provider * queries, struct query * next_query,
 			  struct lookup_table * lookup);
@@ -92,4 +211,69 @@ int get_next_query_lookup(struct query_provider * queries, struct query * next_q
  */
 int get_next_query_trajectories(struct query_provider * queries, struct query * next_query);
 
+/**
+ * @struct query_writer : writer of a query file with a header
+ *
+ * @path : path of the file
+ * @file : the file written
+ * @header : the header, completed as the queries are written
+ * @codec : state of the compression
+ * @records : records not written yet
+ * @nb_records : number of records in @records
+ * @chunk : buffer of a compressed chunk, NULL for raw records
+ */
+struct query_writer {
+	char *path;
+	FILE *file;
+	struct query_header header;
+	struct query_codec codec;
+	uint32_t records[QUERY_CHUNK_SIZE];
+	size_t nb_records;
+	unsigned char *chunk;
+};
+
+/**
+ * @open_query_writer : create the query file @path
+ *
+ * @writer : the writer to initialise
+ * @path : the path of the file
+ * @encoding : the encoding of its records
+ *
+ * @remark : @writer must be closed with @close_query_writer
+ */
+void open_query_writer(struct query_writer *writer, char *path,
+		       Query_encoding encoding);
+
+/**
+ * @write_query : append a query to the file of @writer
+ *
+ * @writer : the writer
+ * @type : ADD or REMOVE
+ * @index : the index of the element, at most QUERY_INDEX_MASK
+ */
+void write_query(struct query_writer *writer, Query_type type,
+		 unsigned int index);
+
+/**
+ * @close_query_writer : write the last records and the final header, and close the file of @writer
+ *
+ * @writer : the writer to close
+ *
+ * @return NO_ERROR if the file was written, IO_ERROR otherwise
+ */
+Error_enum close_query_writer(struct query_writer *writer);
+
+/**
+ * @convert_legacy_queries : write the queries of the legacy file @legacy_path in the file @path, with a header and the type of every query
+ *
+ * @legacy_path : the file of raw indices
+ * @path : the query file to write
+ * @parity : 1 if an index is alternately inserted and removed, as with options -m and -o, 0 if every index is an insertion, as with option -p
+ * @encoding : the encoding of the records of @path
+ *
+ * @return NO_ERROR if no error happens and something else otherwise
+ */
+Error_enum convert_legacy_queries(char *legacy_path, char *path, int parity,
+				  Query_encoding encoding);
+
 #endif
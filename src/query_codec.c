@@ -0,0 +1,177 @@
+/**
+This module compresses the records of a query file: each index is replaced by its difference with the previous index of the same type of query, zigzag encoded so that small negative differences stay small, and the values are packed with the Stream VByte scheme, whose unpacking is vectorised.
+**/
+#include "utils.h"
+#include "query.h"
+#include "query_codec.h"
+
+#include <string.h>
+#include <assert.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define QUERY_CODEC_X86
+#endif
+
+/**
+ * Bit of a difference giving its sign, the differences being taken modulo 2^31
+ */
+#define DELTA_SIGN_BIT 0x40000000u
+
+typedef const unsigned char *(*unpack_function) (const unsigned char *,
+						 const unsigned char *, size_t,
+						 uint32_t *);
+
+static unpack_function unpack_values = NULL;
+
+void initialise_query_codec(struct query_codec *codec)
+{
+	codec->previous[0] = codec->previous[1] = 0;
+}
+
+/**
+ * @value_length : number of bytes, minus one, needed by @value
+ */
+static unsigned int value_length(uint32_t value)
+{
+	if (value < (1u << 8))
+		return 0;
+	if (value < (1u << 16))
+		return 1;
+	if (value < (1u << 24))
+		return 2;
+	return 3;
+}
+
+size_t encode_query_chunk(struct query_codec *codec, uint32_t * records,
+			  size_t nb, unsigned char *bytes)
+{
+	unsigned char *control = bytes, *data = bytes + (nb + 3) / 4;
+	uint32_t index, delta, value;
+	unsigned int op, length, j;
+	size_t i;
+	assert(nb <= QUERY_CHUNK_SIZE);
+	memset(control, 0, (nb + 3) / 4);
+	for (i = 0; i < nb; i++) {
+		op = records[i] >> 31;
+		index = records[i] & QUERY_INDEX_MASK;
+		delta = (index - codec->previous[op]) & QUERY_INDEX_MASK;
+		codec->previous[op] = index;
+		/* zigzag on 31 bits, the type of the query taking the last one */
+		value = delta & DELTA_SIGN_BIT ?
+		    ((~delta << 1) | 1) & QUERY_INDEX_MASK : delta << 1;
+		value = value << 1 | op;
+		length = value_length(value);
+		control[i / 4] |= (unsigned char)(length << (2 * (i % 4)));
+		for (j = 0; j <= length; j++)
+			*(data++) = (unsigned char)(value >> (8 * j));
+	}
+	return (size_t)(data - bytes);
+}
+
+/**
+ * @unpack_scalar : unpack @nb values of @data described by @control in @values
+ *
+ * @return the end of the bytes used
+ */
+static const unsigned char *unpack_scalar(const unsigned char *control,
+					  const unsigned char *data, size_t nb,
+					  uint32_t * values)
+{
+	unsigned int length, j;
+	size_t i;
+	for (i = 0; i < nb; i++) {
+		length = (control[i / 4] >> (2 * (i % 4))) & 3;
+		values[i] = 0;
+		for (j = 0; j <= length; j++)
+			values[i] |= (uint32_t) * (data++) << (8 * j);
+	}
+	return data;
+}
+
+#ifdef QUERY_CODEC_X86
+/**
+ * Shuffle moving the bytes of four values into four words, for each control byte, and number of bytes of the four values
+ */
+static unsigned char shuffles[256][16];
+static unsigned char lengths[256];
+
+/**
+ * @initialise_shuffles : fill @shuffles and @lengths
+ */
+static void initialise_shuffles(void)
+{
+	unsigned int control, i, j, length, position;
+	for (control = 0; control < 256; control++) {
+		position = 0;
+		for (i = 0; i < 4; i++) {
+			length = ((control >> (2 * i)) & 3) + 1;
+			/* a byte of the shuffle with its high bit set gives zero */
+			for (j = 0; j < 4; j++)
+				shuffles[control][4 * i + j] = (unsigned char)
+				    (j < length ? position + j : 0x80);
+			position += length;
+		}
+		lengths[control] = (unsigned char)position;
+	}
+}
+
+__attribute__ ((target("ssse3")))
+static const unsigned char *unpack_ssse3(const unsigned char *control,
+					 const unsigned char *data, size_t nb,
+					 uint32_t * values)
+{
+	__m128i packed;
+	size_t i;
+	for (i = 0; i + 4 <= nb; i += 4) {
+		packed = _mm_loadu_si128((const __m128i *)data);
+		packed = _mm_shuffle_epi8(packed,
+					  _mm_loadu_si128((const __m128i *)
+							  shuffles[*control]));
+		_mm_storeu_si128((__m128i *) (values + i), packed);
+		data += lengths[*(control++)];
+	}
+	return unpack_scalar(control, data, nb - i, values + i);
+}
+#endif
+
+/**
+ * @choose_unpack_values : pick the best unpacking supported by the processor
+ */
+static void choose_unpack_values(void)
+{
+	unpack_values = unpack_scalar;
+#ifdef QUERY_CODEC_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("ssse3")) {
+		initialise_shuffles();
+		unpack_values = unpack_ssse3;
+	}
+#endif
+}
+
+Error_enum decode_query_chunk(struct query_codec *codec, unsigned char *bytes,
+			      size_t size, size_t nb, uint32_t * records)
+{
+	const unsigned char *end;
+	uint32_t value, op, zigzag, index;
+	size_t i;
+	assert(nb <= QUERY_CHUNK_SIZE);
+	if (NULL == unpack_values)
+		choose_unpack_values();
+	if (size < (nb + 3) / 4)
+		return FILE_FORMAT_ERROR;
+	end = unpack_values(bytes, bytes + (nb + 3) / 4, nb, records);
+	if (end != bytes + size)
+		return FILE_FORMAT_ERROR;
+	for (i = 0; i < nb; i++) {
+		value = records[i];
+		op = value & 1;
+		zigzag = value >> 1;
+		index = (codec->previous[op] + ((zigzag >> 1) ^ -(zigzag & 1)))
+		    & QUERY_INDEX_MASK;
+		codec->previous[op] = index;
+		records[i] = index | (op ? QUERY_REMOVE_FLAG : 0);
+	}
+	return NO_ERROR;
+}
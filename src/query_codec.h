@@ -0,0 +1,70 @@
+/**
+This module compresses the records of a query file: each index is replaced by its difference with the previous index of the same type of query, zigzag encoded so that small negative differences stay small, and the values are packed with the Stream VByte scheme, whose unpacking is vectorised.
+**/
+#ifndef __HEADER_QUERY_CODEC
+#define __HEADER_QUERY_CODEC
+
+#include "utils.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Number of records of a full chunk, the unit of compression
+ */
+#define QUERY_CHUNK_SIZE 4096
+
+/**
+ * Largest size of @nb records once compressed: a control byte for four values, and at most four bytes per value
+ */
+#define QUERY_CHUNK_BYTES(nb) (((nb) + 3) / 4 + 4 * (nb))
+
+/**
+ * Number of bytes that must be readable after the largest compressed chunk, the vectorised unpacking loading 16 bytes at a time
+ */
+#define QUERY_CHUNK_PADDING 16
+
+/**
+ * @struct query_codec : state of the compression of a sequence of chunks
+ *
+ * @previous : the previous index of an ADD record and of a REMOVE record
+ */
+struct query_codec {
+	uint32_t previous[2];
+};
+
+/**
+ * @initialise_query_codec : initialise @codec for the first chunk
+ *
+ * @codec : the state to initialise
+ */
+void initialise_query_codec(struct query_codec *codec);
+
+/**
+ * @encode_query_chunk : compress @nb records
+ *
+ * @codec : the state of the compression, updated
+ * @records : the records to compress
+ * @nb : their number, at most QUERY_CHUNK_SIZE
+ * @bytes : where the compressed records are written, at least QUERY_CHUNK_BYTES(@nb) bytes
+ *
+ * @return the number of bytes written
+ */
+size_t encode_query_chunk(struct query_codec *codec, uint32_t * records,
+			  size_t nb, unsigned char *bytes);
+
+/**
+ * @decode_query_chunk : uncompress @nb records
+ *
+ * @codec : the state of the compression, updated
+ * @bytes : the compressed records, in a buffer of at least QUERY_CHUNK_BYTES(@nb) + QUERY_CHUNK_PADDING bytes
+ * @size : the number of bytes of the compressed records
+ * @nb : the number of records, at most QUERY_CHUNK_SIZE
+ * @records : where the records are written
+ *
+ * @return NO_ERROR if the records take exactly @size bytes, FILE_FORMAT_ERROR otherwise
+ */
+Error_enum decode_query_chunk(struct query_codec *codec, unsigned char *bytes,
+			      size_t size, size_t nb, uint32_t * records);
+
+#endif
@@ -4,53 +4,274 @@ This module contains the implementation of a collection of set with O(1) removal
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "set.h"
 #include "utils.h"
 
+/**
+ * Number of chunk indices a set keeps when it is emptied
+ */
+#define SET_MIN_CHUNKS 4
+
+/**
+ * Set index of an element in no set, in a membership table with 16-bit indices
+ */
+#define COMPACT_NOT_IN_SET ((uint16_t)-1)
+
+/**
+ * @initialise_membership_common : allocate the rows of @membership, no element being in a set
+ */
+static void initialise_membership_common(struct set_membership *membership,
+					 unsigned int nb_levels,
+					 unsigned int range, int compact)
+{
+	size_t index_size = compact ? sizeof(uint16_t) : sizeof(unsigned int);
+	membership->compact = compact;
+	membership->nb_levels = nb_levels;
+	membership->nb_attached = 0;
+	membership->range = range;
+	membership->entry_size = index_size + sizeof(unsigned int);
+	membership->row_size = nb_levels * membership->entry_size;
+	membership->rows = malloc_wrapper(membership->row_size * range);
+	memset(membership->rows, -1, membership->row_size * range);
+}
+
+void initialise_set_membership(struct set_membership *membership,
+			       unsigned int nb_levels, unsigned int nb_sets,
+			       unsigned int range)
+{
+	initialise_membership_common(membership, nb_levels, range,
+				     nb_sets <= SET_COMPACT_MAX_SETS);
+	membership->shared = 1;
+}
+
+void free_set_membership(struct set_membership *membership)
+{
+	free(membership->rows);
+	membership->rows = NULL;
+	membership->range = 0;
+}
+
+/**
+ * @initialise_private_membership : gives a membership table with a single level, owned by a set or a collection
+ */
+static struct set_membership *initialise_private_membership(unsigned int range)
+{
+	struct set_membership *membership =
+	    malloc_wrapper(sizeof(*membership));
+	initialise_membership_common(membership, 1, range, 0);
+	membership->shared = 0;
+	return membership;
+}
+
+/**
+ * @resize_membership : let @membership hold the elements from 0 to @range - 1, if it does not already
+ */
+static void resize_membership(struct set_membership *membership,
+			      unsigned int range)
+{
+	unsigned char *rows;
+	if (range <= membership->range)
+		return;
+	rows = malloc_wrapper(membership->row_size * range);
+	memcpy(rows, membership->rows,
+	       membership->row_size * membership->range);
+	memset(rows + membership->row_size * membership->range, -1,
+	       membership->row_size * (range - membership->range));
+	free(membership->rows);
+	membership->rows = rows;
+	membership->range = range;
+}
+
+/**
+ * @entry_set : gives the entry of @element in the level of the collection of @set
+ */
+static unsigned char *entry_set(struct set *set, unsigned int element)
+{
+	return set->membership->rows +
+	    (size_t)element * set->membership->row_size +
+	    (size_t)set->level * set->membership->entry_size;
+}
+
+/**
+ * @index_set : gives the index of the set of @element in the collection of @set, NOT_IN_SET if there is none
+ */
+static unsigned int index_set(struct set *set, unsigned int element)
+{
+	unsigned int index;
+	uint16_t compact;
+	/* the entries are not aligned when the indices are compact */
+	if (!set->membership->compact) {
+		memcpy(&index, entry_set(set, element), sizeof(index));
+		return index;
+	}
+	memcpy(&compact, entry_set(set, element), sizeof(compact));
+	return COMPACT_NOT_IN_SET == compact ? NOT_IN_SET : compact;
+}
+
+/**
+ * @position_set : gives the position of @element in its set of the collection of @set
+ */
+static unsigned int position_set(struct set *set, unsigned int element)
+{
+	unsigned int position;
+	memcpy(&position, entry_set(set, element) + set->membership->entry_size -
+	       sizeof(position), sizeof(position));
+	return position;
+}
+
+/**
+ * @place_set : record that @element is in the set @index of the collection of @set, at @position
+ */
+static void place_set(struct set *set, unsigned int element,
+		      unsigned int index, unsigned int position)
+{
+	unsigned char *entry = entry_set(set, element);
+	uint16_t compact = (uint16_t)index;
+	if (set->membership->compact)
+		memcpy(entry, &compact, sizeof(compact));
+	else
+		memcpy(entry, &index, sizeof(index));
+	memcpy(entry + set->membership->entry_size - sizeof(position),
+	       &position, sizeof(position));
+}
+
+/**
+ * @initialise_pool : allocate a pool of chunks holding at least @max_size elements
+ */
+static struct set_pool *initialise_pool(unsigned int max_size)
+{
+	struct set_pool *pool = malloc_wrapper(sizeof(*pool));
+	pool->nb_chunks = MAX(1, (max_size + SET_CHUNK_SIZE - 1) / SET_CHUNK_SIZE);
+	pool->slots = malloc_wrapper(sizeof(*pool->slots) * SET_CHUNK_SIZE *
+				     pool->nb_chunks);
+	pool->nb_used = 0;
+	pool->free_chunk = NOT_IN_SET;
+	return pool;
+}
+
+static void free_pool(struct set_pool *pool)
+{
+	free(pool->slots);
+	free(pool);
+}
+
+/**
+ * @take_chunk : gives a chunk of @pool, reusing the ones given back first and growing @pool if needed
+ */
+static unsigned int take_chunk(struct set_pool *pool)
+{
+	unsigned int chunk = pool->free_chunk;
+	if (NOT_IN_SET != chunk) {
+		pool->free_chunk = pool->slots[(size_t)chunk * SET_CHUNK_SIZE];
+		return chunk;
+	}
+	if (pool->nb_used == pool->nb_chunks) {
+		/* RESIZE_FACTOR(1) is 1, so without this the pool would never grow past one chunk */
+		pool->nb_chunks++;
+		pool->slots = realloc_wrapper(pool->slots, &(pool->nb_chunks),
+					      sizeof(*pool->slots) *
+					      SET_CHUNK_SIZE);
+	}
+	return pool->nb_used++;
+}
+
+/**
+ * @give_back_chunk : put @chunk back in the free list of @pool
+ */
+static void give_back_chunk(struct set_pool *pool, unsigned int chunk)
+{
+	pool->slots[(size_t)chunk * SET_CHUNK_SIZE] = pool->free_chunk;
+	pool->free_chunk = chunk;
+}
+
+/**
+ * @slot_set : gives the slot of the pool holding the element of @set at @position
+ */
+static unsigned int *slot_set(struct set *set, unsigned int position)
+{
+	return set->pool->slots +
+	    (size_t)set->chunks[position / SET_CHUNK_SIZE] * SET_CHUNK_SIZE +
+	    position % SET_CHUNK_SIZE;
+}
+
+/**
+ * @resize_chunks : let @set index @max_chunks chunks
+ */
+static void resize_chunks(struct set *set, unsigned int max_chunks)
+{
+	unsigned int *chunks = realloc(set->chunks,
+				       sizeof(*chunks) * max_chunks);
+	/* only a growth can not be done in place */
+	if (NULL == chunks) {
+		if (max_chunks < set->max_chunks)
+			return;
+		perror("realloc");
+		exit(EXIT_FAILURE);
+	}
+	set->chunks = chunks;
+	set->max_chunks = max_chunks;
+}
+
+/**
+ * @initialise_set_common : initialise @set, whose elements are in @pool and whose membership is the column @level of @membership
+ */
+static void initialise_set_common(struct set * set, struct set_pool *pool,
+				  struct set_membership *membership,
+				  unsigned int level, unsigned int set_index)
+{
+	set->pool = pool;
+	set->membership = membership;
+	set->level = level;
+	set->chunks = malloc_wrapper(sizeof(*set->chunks) * SET_MIN_CHUNKS);
+	set->max_chunks = SET_MIN_CHUNKS;
+	set->range = membership->range;
+	set->card = 0;
+	set->index = set_index;
+}
+
 void initialise_set(struct set * set, unsigned int max_size, unsigned int range,
 		    unsigned int set_index)
 {
 	assert(range >= max_size);
-	set->elm_ptr = malloc_wrapper(sizeof(*(set->elm_ptr)) * range);
-	memset(set->elm_ptr, -1, sizeof(*(set->elm_ptr)) * range);
-	set->elements = malloc_wrapper(sizeof(unsigned int) * max_size);
-	set->max_card = max_size;
-	set->range = range;
-	set->card = 0;
-	set->index = set_index;
+	initialise_set_common(set, initialise_pool(max_size),
+			      initialise_private_membership(range), 0,
+			      set_index);
 }
 
 void free_set(struct set * set)
 {
-	free(set->elements);
-	set->elements = NULL;
-	free(set->elm_ptr);
-	set->elm_ptr = NULL;
+	free(set->chunks);
+	set->chunks = NULL;
+	free_pool(set->pool);
+	set->pool = NULL;
+	if (!set->membership->shared) {
+		free_set_membership(set->membership);
+		free(set->membership);
+	}
+	set->membership = NULL;
 }
 
-static void initialise_set_n_common(struct set * sets, unsigned int n, unsigned int max_size,
-			     unsigned int range)
+static void initialise_set_n_common(struct set * sets, unsigned int n,
+				    unsigned int max_size,
+				    struct set_membership *membership,
+				    unsigned int level)
 {
 	unsigned int i;
-	initialise_set(sets, max_size, range, 0);
-	for (i = 1; i < n; i++) {
-		sets[i].elm_ptr = sets[0].elm_ptr;
-		sets[i].elements = malloc_wrapper(sizeof(unsigned int) * max_size);
-		sets[i].max_card = max_size;
-		sets[i].range = range;
-		sets[i].card = 0;
-		sets[i].index = i;
-	}
+	for (i = 0; i < n; i++)
+		initialise_set_common(sets + i, 0 == i ?
+				      initialise_pool(max_size) : sets[0].pool,
+				      membership, level, i);
 }
 
 static void free_set_n_common(struct set * sets, unsigned int n)
 {
 	free_set(sets);
-	for (; 0 < n;) {
+	for (; 1 < n;) {
 		n--;
-		free(sets[n].elements);
-		sets[n].elements = NULL;
+		free(sets[n].chunks);
+		sets[n].chunks = NULL;
 	}
 }
 
@@ -60,7 +281,21 @@ initialise_set_collection(struct set_collection * sets, unsigned int n,
 {
 	sets->sets = (struct set *) malloc_wrapper(sizeof(*(sets->sets)) * n);
 	sets->nb_sets = n;
-	initialise_set_n_common(sets->sets, n, max_size, range);
+	initialise_set_n_common(sets->sets, n, max_size,
+				initialise_private_membership(range), 0);
+}
+
+void
+initialise_set_collection_shared(struct set_collection * sets, unsigned int n,
+				 unsigned int max_size,
+				 struct set_membership * membership)
+{
+	assert(membership->nb_attached < membership->nb_levels);
+	assert(!membership->compact || n <= SET_COMPACT_MAX_SETS);
+	sets->sets = (struct set *) malloc_wrapper(sizeof(*(sets->sets)) * n);
+	sets->nb_sets = n;
+	initialise_set_n_common(sets->sets, n, max_size, membership,
+				membership->nb_attached++);
 }
 
 void free_set_collection(struct set_collection * sets)
@@ -74,28 +309,52 @@ void free_set_collection(struct set_collection * sets)
 void add_element_set(struct set * set, unsigned int element)
 {
 	assert(element < set->range);
-	assert((unsigned)-1 == set->elm_ptr[element].set_index);
-	assert(set->card < set->max_card);
-	set->elements[set->card] = element;
-	set->elm_ptr[element].set_index = set->index;
-	set->elm_ptr[element].pointer = set->card;
+	assert(NOT_IN_SET == index_set(set, element));
+	if (0 == set->card % SET_CHUNK_SIZE) {
+		if (set->card / SET_CHUNK_SIZE == set->max_chunks)
+			resize_chunks(set, 2 * set->max_chunks);
+		set->chunks[set->card / SET_CHUNK_SIZE] = take_chunk(set->pool);
+	}
+	*slot_set(set, set->card) = element;
+	place_set(set, element, set->index, set->card);
 	set->card++;
 }
 
 void remove_element_set(struct set * set, unsigned int element)
 {
-	unsigned int position;
-	assert(set->set_index == set->elm_ptr[element].set_index);
+	unsigned int position, last;
+	assert(set->index == index_set(set, element));
 	assert(0 < set->card);
-	position = set->elm_ptr[element].pointer;
+	position = position_set(set, element);
 	set->card--;
-	set->elm_ptr[element].set_index = NOT_IN_SET;
-	set->elm_ptr[element].pointer = NOT_IN_SET;
-	set->elements[position] = set->elements[set->card];
-	set->elm_ptr[set->elements[position]].pointer = position;
+	last = *slot_set(set, set->card);
+	*slot_set(set, position) = last;
+	place_set(set, last, set->index, position);
+	place_set(set, element, NOT_IN_SET, NOT_IN_SET);
+	if (0 == set->card % SET_CHUNK_SIZE) {
+		give_back_chunk(set->pool,
+				set->chunks[set->card / SET_CHUNK_SIZE]);
+		/* the chunk indices shrink with the set, keeping the memory of the collection linear in its elements */
+		if (SET_MIN_CHUNKS < set->max_chunks
+		    && set->card / SET_CHUNK_SIZE < set->max_chunks / 4)
+			resize_chunks(set, set->max_chunks / 2);
+	}
 }
 
+unsigned int get_element_set(struct set * set, unsigned int position)
+{
+	assert(position < set->card);
+	return *slot_set(set, position);
+}
 
+void resize_set_collection(struct set_collection * sets, unsigned int range)
+{
+	unsigned int i;
+	assert(range >= sets->sets[0].range);
+	resize_membership(sets->sets[0].membership, range);
+	for (i = 0; i < sets->nb_sets; i++)
+		sets->sets[i].range = range;
+}
 
 void
 add_element_set_collection(struct set_collection * sets, unsigned int element,
@@ -107,38 +366,45 @@ add_element_set_collection(struct set_collection * sets, unsigned int element,
 
 void remove_element_set_collection(struct set_collection * sets, unsigned int element)
 {
-	assert(NOT_IN_SET != sets->sets[0].elm_ptr[element].set_index);
-	remove_element_set(sets->sets +
-			   sets->sets[0].elm_ptr[element].set_index, element);
+	unsigned int set_index = index_set(sets->sets, element);
+	assert(NOT_IN_SET != set_index);
+	remove_element_set(sets->sets + set_index, element);
 }
 
 
 unsigned int get_set_index(struct set_collection * sets, unsigned int element)
 {
-	return sets->sets[0].elm_ptr[element].set_index;
+	return index_set(sets->sets, element);
 }
 
 void
 remove_all_elements_after_set(struct set_collection * sets, unsigned int set_index,
 			      unsigned int *array, unsigned int *size)
 {
+	struct set *set;
+	unsigned int i, nb, chunk;
 	*size = 0;
 	for (; set_index < sets->nb_sets; set_index++) {
-		unsigned int iter_set;
-		for (iter_set = 0; iter_set < sets->sets[set_index].card;
-		     iter_set++, (*size)++) {
-			array[*size] = sets->sets[set_index].elements[iter_set];
-			sets->sets[set_index].elm_ptr[array[*size]].pointer =
-			    NOT_IN_SET;
-			sets->sets[set_index].elm_ptr[array[*size]].set_index =
-			    NOT_IN_SET;
+		set = sets->sets + set_index;
+		for (chunk = 0; chunk * SET_CHUNK_SIZE < set->card; chunk++) {
+			nb = MIN(SET_CHUNK_SIZE,
+				 set->card - chunk * SET_CHUNK_SIZE);
+			memcpy(array + *size, slot_set(set,
+						       chunk * SET_CHUNK_SIZE),
+			       sizeof(*array) * nb);
+			give_back_chunk(set->pool, set->chunks[chunk]);
+			for (i = 0; i < nb; i++, (*size)++)
+				place_set(set, array[*size], NOT_IN_SET,
+					  NOT_IN_SET);
 		}
-		sets->sets[set_index].card = 0;
+		set->card = 0;
+		if (SET_MIN_CHUNKS < set->max_chunks)
+			resize_chunks(set, SET_MIN_CHUNKS);
 	}
 
 }
 
 int has_element_set_collection(struct set_collection * sets, unsigned int element)
 {
-	return NOT_IN_SET != sets->sets[0].elm_ptr[element].set_index;
+	return NOT_IN_SET != index_set(sets->sets, element);
 }
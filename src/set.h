@@ -4,36 +4,79 @@ This module contains the implementation of a collection of set with O(1) removal
 #ifndef __HEADER_SET_STRUCTURE
 #define __HEADER_SET_STRUCTURE
 
+#include <stddef.h>
+
 #define NOT_IN_SET ((unsigned int)-1)
 
 /**
- * @struct  element_pointer : structure specifying the set and the position of the element in its set.
+ * Largest number of sets of a collection whose indices are stored on 16 bits in a membership table
+ */
+#define SET_COMPACT_MAX_SETS 0xFFFEu
+
+/**
+ * @struct set_membership : set index and position of every element in the collections attached to it, one collection per level, stored element by element so that the levels of an element are contiguous
  *
- * @set_index : set of the element, equal NOT_IN_SET if the element is not in any set.
- * @pointer : position of the element in its set
+ * @rows : one row per element, made of an entry per level giving the set index of the element and its position in this set, without padding
+ * @row_size : number of bytes of a row
+ * @entry_size : number of bytes of an entry
+ * @range : number of rows, the elements being from 0 to @range - 1
+ * @nb_levels : number of collections that can be attached
+ * @nb_attached : number of collections attached so far
+ * @compact : 1 if the set indices take 16 bits, 0 if they take 32
+ * @shared : 1 if the table is given to several collections by its owner, 0 if it belongs to a single collection or set
  */
-struct element_pointer{
-	unsigned int set_index;
-	unsigned int pointer;
+struct set_membership{
+	unsigned char *rows;
+	size_t row_size;
+	size_t entry_size;
+	unsigned int range;
+	unsigned int nb_levels;
+	unsigned int nb_attached;
+	int compact;
+	int shared;
+};
+
+/**
+ * Number of elements of a chunk of a set pool, a power of two
+ */
+#define SET_CHUNK_SIZE 64
+
+/**
+ * @struct set_pool : chunks of elements shared by the sets of a collection, so that its memory follows the number of elements whatever the number of sets
+ *
+ * @slots : the chunks, SET_CHUNK_SIZE elements each
+ * @nb_chunks : number of chunks allocated
+ * @nb_used : number of chunks ever handed out
+ * @free_chunk : first chunk of the list of the chunks given back, NOT_IN_SET if there is none, the first slot of a free chunk giving the next one
+ */
+struct set_pool{
+	unsigned int *slots;
+	size_t nb_chunks;
+	unsigned int nb_used;
+	unsigned int free_chunk;
 };
 
 /**
  * @struct set : a data structure encoding a set.
  *
- * @set_index : index of the set.
+ * @index : index of the set.
  * @card : current number of elements in the set.
- * @max_card : maximum number of element that can be stored in the set before any reallocation.
  * @range : range of the elements in the sets (from 0 to range-1).
- * @elements : array of the indices of all elements in the set
- * @elm_ptr : array of struct element_pointer for all elements between 0 and @range
+ * @chunks : chunks of @pool holding the elements of the set, the element at position i being in the chunk i / SET_CHUNK_SIZE
+ * @max_chunks : size of @chunks
+ * @pool : the pool of the elements, shared by the sets of a collection
+ * @membership : the set index and the position of all elements between 0 and @range, shared by the sets of a collection
+ * @level : column of @membership used by the collection of the set
  */
 struct set{
 	unsigned int index;
 	unsigned int card;
-	unsigned int max_card;
 	unsigned int range;
-	unsigned int *elements;
-	struct element_pointer *elm_ptr;
+	unsigned int *chunks;
+	unsigned int max_chunks;
+	struct set_pool *pool;
+	struct set_membership *membership;
+	unsigned int level;
 };
 
 /**
@@ -51,7 +94,7 @@ struct set_collection{
  * @initialise_set : initialise the given set
  *
  * @set : the set to initialise
- * @max_size : the maximum size of the set
+ * @max_size : the number of elements the set holds before its pool grows
  * @range : the range of the elements in the set
  * @set_index : the index of the set
  *
@@ -76,6 +119,7 @@ void free_set(struct set * set);
  * @element : the element to add in @set
  *
  * @warning : require that @element is not in @set
+ * @remark : the pool of @set grows if it is full
  */
 void add_element_set(struct set * set, unsigned int element);
 
@@ -86,16 +130,27 @@ void add_element_set(struct set * set, unsigned int element);
  * @element : the element to remove from @set
  *
  * @warning : requires that @element is indeedd in @set
+ * @remark : the last element of @set takes the position of @element
  */
 void remove_element_set(struct set * set, unsigned int element);
 
+/**
+ * @get_element_set : gives the element of @set at @position
+ *
+ * @set : the set
+ * @position : the position, lower than the cardinal of @set
+ *
+ * @return the element
+ */
+unsigned int get_element_set(struct set * set, unsigned int position);
+
 
 /**
  * @initialise_set_collection : initialises @sets
  *
  * @sets : the set collection to initialise.
  * @n : the number of set in the collection to create.
- * @max_size : the maximum size of each set in the collection.
+ * @max_size : the number of elements the sets hold together before their pool grows.
  * @range : the range of the element in the sets of the collection.
  *
  * @remark : @sets must be properly freed with @free_set_collection to avoid memory leaks
@@ -103,6 +158,42 @@ void remove_element_set(struct set * set, unsigned int element);
 void initialise_set_collection(struct set_collection * sets, unsigned int n,
 			       unsigned int max_size, unsigned int range);
 
+/**
+ * @initialise_set_membership : initialise a membership table that collections of sets can share
+ *
+ * @membership : the table to initialise
+ * @nb_levels : the number of collections that will be attached to @membership
+ * @nb_sets : the number of sets of each of these collections
+ * @range : the range of the elements in the sets
+ *
+ * @remark : the set indices take 16 bits when @nb_sets is at most SET_COMPACT_MAX_SETS
+ * @remark : @membership must be freed with @free_set_membership once its collections are freed
+ */
+void initialise_set_membership(struct set_membership * membership,
+			       unsigned int nb_levels, unsigned int nb_sets,
+			       unsigned int range);
+
+/**
+ * @free_set_membership : free @membership
+ *
+ * @membership : the table to free
+ */
+void free_set_membership(struct set_membership * membership);
+
+/**
+ * @initialise_set_collection_shared : initialises @sets, whose membership is kept in the next free level of @membership
+ *
+ * @sets : the set collection to initialise.
+ * @n : the number of set in the collection to create, at most the number of sets given to @membership.
+ * @max_size : the number of elements the sets hold together before their pool grows.
+ * @membership : the membership table of @sets, with a level not attached yet.
+ *
+ * @remark : @sets must be properly freed with @free_set_collection to avoid memory leaks, which does not free @membership
+ */
+void initialise_set_collection_shared(struct set_collection * sets,
+				      unsigned int n, unsigned int max_size,
+				      struct set_membership * membership);
+
 /**
  * @free_set_collection : free @sets
  *
@@ -113,6 +204,16 @@ void initialise_set_collection(struct set_collection * sets, unsigned int n,
 
 void free_set_collection(struct set_collection * sets);
 
+/**
+ * @resize_set_collection : let the sets of @sets hold the elements from 0 to @range - 1, keeping their content
+ *
+ * @sets : the set collection to resize
+ * @range : the new range of the elements, at least the current one
+ *
+ * @remark : a shared membership table grows with the first of its collections resized
+ */
+void resize_set_collection(struct set_collection * sets, unsigned int range);
+
 /**
  * @add_element_set_collection : adds @element to the set of @sets with index @set_index
  *
@@ -1,79 +1,238 @@
 /**
-This file contains a program to create a queryfile from an datafile in a sliding window setting.
+This file contains a program to create a queryfile from an datafile in a sliding window setting, in the legacy format or compressed with option -z. Only the timestamps of the current window are kept, so that the datafile can be a stream of any length.
  **/
 
-#define _ISOC99_SOURCE
+#define _POSIX_C_SOURCE 200809L
 
 #include "utils.h"
+#include "query.h"
+#include "mapped_file.h"
 
 #include <stdint.h>
-#include <time.h>
 #include <stdlib.h>
+#include <limits.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
-#include <assert.h>
 #include <string.h>
 #include <stdio.h>
 
+/**
+ * Number of indices written at once in the legacy format
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+/**
+ * Size of the buffer of the readable copy of the indices
+ */
+#define READABLE_BUFFER_SIZE (1 << 20)
+
+/**
+ * Initial number of timestamps of the window, a power of two
+ */
+#define INITIAL_WINDOW 1024
+
+/**
+ * @struct window : ring of the timestamps of the points of the window, the ith point being at i & @mask
+ *
+ * @timestamps : the ring
+ * @mask : its size minus one, a power of two
+ * @oldest : index of the oldest point of the window
+ * @current : index of the next point read
+ */
+struct window {
+	unsigned int *timestamps;
+	unsigned int mask;
+	unsigned int oldest;
+	unsigned int current;
+};
+
+/**
+ * @struct query_output : the query file written
+ *
+ * @fd : its file descriptor in the legacy format
+ * @buffer : indices not written yet in the legacy format
+ * @nb : number of indices in @buffer
+ * @writer : the writer of a compressed file, NULL in the legacy format
+ * @readable : the readable copy of the indices, NULL if not asked
+ */
+struct query_output {
+	int fd;
+	unsigned int *buffer;
+	size_t nb;
+	struct query_writer *writer;
+	FILE *readable;
+};
+
+static void usage(char *name)
+{
+	fprintf(stderr,
+		"%s [-z] [-r readable_output] datafile queryfile duration\n",
+		name);
+	fprintf(stderr, "\t-z : compress the queryfile\n");
+	fprintf(stderr,
+		"\t-r : also write the indices in text, one per line\n");
+	fprintf(stderr, "\tdatafile : - for the standard input\n");
+}
+
+/**
+ * @grow_window : double the size of the ring of @window, full
+ */
+static void grow_window(struct window *window)
+{
+	unsigned int *timestamps =
+	    malloc_wrapper(sizeof(*timestamps) * 2 * (window->mask + 1));
+	unsigned int i;
+	for (i = window->oldest; i != window->current; i++)
+		timestamps[i & (2 * window->mask + 1)] =
+		    window->timestamps[i & window->mask];
+	free(window->timestamps);
+	window->timestamps = timestamps;
+	window->mask = 2 * window->mask + 1;
+}
+
+/**
+ * @flush_output : write the indices buffered by @output, a pipe possibly taking them in several times
+ */
+static void flush_output(struct query_output *output)
+{
+	char *bytes = (char *)output->buffer;
+	size_t size = output->nb * sizeof(*output->buffer);
+	ssize_t tmp;
+	while (size) {
+		tmp = write_wrapper(output->fd, bytes, size, 1);
+		bytes += tmp;
+		size -= (size_t)tmp;
+	}
+	output->nb = 0;
+}
+
+/**
+ * @output_query : append a query to @output
+ */
+static void output_query(struct query_output *output, Query_type type,
+			 unsigned int index)
+{
+	if (NULL != output->readable)
+		fprintf(output->readable, "%u\n", index);
+	if (NULL != output->writer) {
+		write_query(output->writer, type, index);
+		return;
+	}
+	/* the parity of the occurrences of an index gives its type */
+	output->buffer[output->nb] = index;
+	if (OUTPUT_BUFFER_SIZE == ++(output->nb))
+		flush_output(output);
+}
+
 int main(int argc, char *argv[])
 {
-	unsigned int out_buffer[BUFSIZ];
-	char buffer[BUFSIZ];
-	unsigned int duration, current, out_current, oldest;
-	int out;
-	FILE *in, *out_readable;
-	unsigned int *array =
-	    (unsigned int *)calloc_wrapper(100000000, sizeof(unsigned int)),
-	    w_max = 0;
-	if (argc != 5) {
-		fprintf(stderr, "%s in out out_read duration\n", argv[0]);
+	struct window window;
+	struct query_output output;
+	char *line = NULL, *cursor, *readable_path = NULL;
+	size_t line_size = 0, line_number = 0;
+	ssize_t length;
+	unsigned int duration, timestamp, limit = UINT_MAX, w_max = 0;
+	int opt, compressed = 0, error;
+	FILE *in;
+	while ((opt = getopt(argc, argv, "hzr:")) != -1) {
+		switch (opt) {
+		case 'z':
+			compressed = 1;
+			limit = QUERY_INDEX_MASK;
+			break;
+		case 'r':
+			readable_path = optarg;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return EXIT_SUCCESS;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind != 3) {
+		usage(argv[0]);
 		return EXIT_FAILURE;
 	}
-	in = fopen_wrapper(argv[1], "r");
-	out = open_wrapper(argv[2], O_WRONLY | O_CREAT | O_TRUNC);
-	out_readable = fopen_wrapper(argv[3], "w");
-	if (strtoui_wrapper(argv[4], &duration)) {
+	if (strtoui_wrapper(argv[optind + 2], &duration)) {
 		fprintf(stderr, "Position duration required\n");
 		return EXIT_FAILURE;
 	}
-	out_current = oldest = current = 0;
-	while (fgets(buffer, BUFSIZ, in)) {
-		if (strtoui_wrapper(strtok(buffer, "\t \n"), array + current)) {
-			fprintf(stderr, "Invalid input file\n");
+	in = 0 == strcmp(argv[optind], "-") ? stdin :
+	    fopen_wrapper(argv[optind], "r");
+	output.writer = NULL;
+	output.buffer = NULL;
+	output.nb = 0;
+	if (compressed) {
+		output.writer = malloc_wrapper(sizeof(*output.writer));
+		open_query_writer(output.writer, argv[optind + 1],
+				  QUERY_ENCODING_STREAMVBYTE);
+	} else {
+		output.fd = open_wrapper(argv[optind + 1],
+					 O_WRONLY | O_CREAT | O_TRUNC);
+		output.buffer = malloc_wrapper(sizeof(*output.buffer) *
+					       OUTPUT_BUFFER_SIZE);
+	}
+	output.readable = NULL;
+	if (NULL != readable_path) {
+		output.readable = fopen_wrapper(readable_path, "w");
+		setvbuf(output.readable, NULL, _IOFBF, READABLE_BUFFER_SIZE);
+	}
+	window.mask = INITIAL_WINDOW - 1;
+	window.timestamps = malloc_wrapper(sizeof(*window.timestamps) *
+					   INITIAL_WINDOW);
+	window.oldest = window.current = 0;
+	while (-1 != (length = getline(&line, &line_size, in))) {
+		line_number++;
+		cursor = line;
+		if (!check_end_of_line(&cursor, line + length))
+			continue;
+		cursor = line;
+		if (parse_unsigned_field(&cursor, line + length, &timestamp)) {
+			fprintf(stderr, "Invalid input file, line %lu\n",
+				(unsigned long)line_number);
 			return EXIT_FAILURE;
 		}
-		w_max = max(current - oldest, w_max);
-		while (oldest < current
-		       && array[oldest] + duration < array[current]) {
-			if (out_current == BUFSIZ) {
-				write_wrapper(out, out_buffer, BUFSIZ,
-					      sizeof(unsigned int));
-				out_current = 0;
-			}
-			out_buffer[out_current] = oldest;
-			fprintf(out_readable, "%d\n", oldest);
-			out_current++;
-			oldest++;
+		if (limit == window.current) {
+			fprintf(stderr,
+				"Too many points, the indices are limited to %u\n",
+				limit);
+			return EXIT_FAILURE;
 		}
-		if (out_current == BUFSIZ) {
-			write_wrapper(out, out_buffer, BUFSIZ,
-				      sizeof(unsigned int));
-			out_current = 0;
+		if (window.current - window.oldest == window.mask + 1)
+			grow_window(&window);
+		window.timestamps[window.current & window.mask] = timestamp;
+		w_max = MAX(window.current - window.oldest, w_max);
+		while (window.oldest < window.current
+		       && window.timestamps[window.oldest & window.mask] +
+		       duration < timestamp) {
+			output_query(&output, REMOVE, window.oldest);
+			window.oldest++;
 		}
-		out_buffer[out_current] = current;
-		fprintf(out_readable, "%d\n", current);
-		out_current++;
-		current++;
+		output_query(&output, ADD, window.current);
+		window.current++;
+	}
+	printf("%u\n", w_max);
+	error = 0;
+	if (compressed) {
+		error = close_query_writer(output.writer);
+		free(output.writer);
+	} else {
+		flush_output(&output);
+		close(output.fd);
+		free(output.buffer);
+	}
+	if (NULL != output.readable && fclose(output.readable)) {
+		perror("fclose");
+		error = 1;
 	}
-	if (out_current != 0)
-		write_wrapper(out, out_buffer, out_current,
-			      sizeof(unsigned int));
-	printf("%d\n", w_max);
-	close(out);
-	fclose(out_readable);
-	fclose(in);
-	return 0;
+	if (stdin != in)
+		fclose(in);
+	free(line);
+	free(window.timestamps);
+	return error ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -50,6 +50,15 @@ The module contains wrappers for some standard C librairy function and some othe
 #define UNUSED_FUNCTION(x) UNUSED_ ## x
 #endif
 
+/**
+ * Hint that the memory at an address will soon be read
+ */
+#ifdef __GNUC__
+#define PREFETCH(x) __builtin_prefetch(x)
+#else
+#define PREFETCH(x) ((void)(x))
+#endif
+
 /**
  * An enum for some error return value.
  *